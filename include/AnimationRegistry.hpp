@@ -0,0 +1,155 @@
+#ifndef ANIMATIONREGISTRY_HPP
+#define ANIMATIONREGISTRY_HPP
+
+#include <tuple>
+#include <utility>
+#include <string.h>
+
+#include "Arena.hpp"
+#include "FrameBuffer.hpp"
+
+// Compile-time list of the available animations, the current one is selected by index or by name.
+// The animations are stored by value in a tuple and called through templates: no virtual functions and nothing
+// allocated by the registry.
+//
+// Each animation must provide:
+//   Animation(FrameBuffer &ledmatrix, Arena &arena)     -- its buffers are allocated in the arena
+//   static size_t arenaSize(uint rows, uint cols)       -- arena bytes allocated by the constructor
+//   void nextFrame()
+//   uint getFramerate() const
+//   void setFramerate(uint framerate)
+//   const char *getName() const
+//   void setColor(const RgbColor &color)
+//   int formatStatus(char *buffer, size_t size) const  -- status published on MQTT when the animation changes
+//   void nextImage()                                    -- next picture for image-based animations, no-op otherwise
+//   bool selectImage(const char *name)                  -- picture by name, false if unknown or not image-based
+//   bool statusChanged()                                -- true once when the status changed by itself (e.g. a picture
+//                                                          requested with nextImage() is shown after it was loaded)
+//   void syncFrame(uint32_t frame, uint32_t seed)       -- called before nextFrame() when the frames are synchronized
+//                                                          with other nodes (see FrameSync): align the state on the
+//                                                          shared frame number and seed the random numbers
+template<typename... Animations>
+class AnimationRegistry {
+private:
+    std::tuple<Animations...> animations;
+    uint current;
+
+    // Call f on animation number index, the index comparisons are resolved into a chain of direct calls
+    template<typename F, size_t... I>
+    void visit(uint index, F &&f, std::index_sequence<I...>) {
+        (void)( (index == I ? (f(std::get<I>(animations)), true) : false) || ... );
+    }
+
+    template<typename F, size_t... I>
+    void visit(uint index, F &&f, std::index_sequence<I...>) const {
+        (void)( (index == I ? (f(std::get<I>(animations)), true) : false) || ... );
+    }
+
+    template<typename F>
+    void visit(uint index, F &&f) {
+        visit(index, f, std::index_sequence_for<Animations...>());
+    }
+
+    template<typename F>
+    void visit(uint index, F &&f) const {
+        visit(index, f, std::index_sequence_for<Animations...>());
+    }
+
+public:
+    // Each animation is constructed from the same frame buffer, the arena must be at least arenaSize() bytes
+    AnimationRegistry(FrameBuffer &ledmatrix, Arena &arena) : animations(Animations(ledmatrix, arena)...), current(0) {}
+
+    // Arena bytes needed by all the animations for a matrix of this size
+    static constexpr size_t arenaSize(uint rows, uint cols) {
+        return (Animations::arenaSize(rows, cols) + ... + 0);
+    }
+
+    static constexpr uint size() {
+        return sizeof...(Animations);
+    }
+
+    uint getCurrent() const {
+        return current;
+    }
+
+    void select(uint index) {
+        if ( index < size() ) {
+            current = index;
+        }
+    }
+
+    void selectNext() {
+        current = current < size() - 1 ? current + 1 : 0;
+    }
+
+    // Returns false if there is no animation with this name
+    bool selectByName(const char *name) {
+        for ( uint index = 0; index < size(); index++ ) {
+            if ( strcmp(getName(index), name) == 0 ) {
+                current = index;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const char *getName(uint index) const {
+        const char *name = "";
+        visit(index, [&name](const auto &animation) { name = animation.getName(); });
+        return name;
+    }
+
+    const char *getName() const {
+        return getName(current);
+    }
+
+    void nextFrame() {
+        visit(current, [](auto &animation) { animation.nextFrame(); });
+    }
+
+    void syncFrame(uint32_t frame, uint32_t seed) {
+        visit(current, [frame, seed](auto &animation) { animation.syncFrame(frame, seed); });
+    }
+
+    bool statusChanged() {
+        bool changed = false;
+        visit(current, [&changed](auto &animation) { changed = animation.statusChanged(); });
+        return changed;
+    }
+
+    uint getFramerate() const {
+        uint framerate = 1;
+        visit(current, [&framerate](const auto &animation) { framerate = animation.getFramerate(); });
+        return framerate;
+    }
+
+    void setFramerate(uint framerate) {
+        visit(current, [framerate](auto &animation) { animation.setFramerate(framerate); });
+    }
+
+    int formatStatus(char *buffer, size_t size) const {
+        int len = 0;
+        visit(current, [&](const auto &animation) { len = animation.formatStatus(buffer, size); });
+        return len;
+    }
+
+    // Returns false if no animation has a picture with this name
+    bool selectImage(const char *name) {
+        bool found = false;
+        forEach([&](auto &animation) { found |= animation.selectImage(name); });
+        return found;
+    }
+
+    // Call f on every animation (e.g. to forward a color change)
+    template<typename F>
+    void forEach(F &&f) {
+        std::apply([&f](auto &... animation) { (f(animation), ...); }, animations);
+    }
+
+    template<typename Animation>
+    Animation &get() {
+        return std::get<Animation>(animations);
+    }
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <Arduino.h>
+#include <cstddef>
+#include <string.h>
+
+// Bump allocator on a fixed block of memory, for the buffers of the animations.
+// The memory is reserved once (StaticArena below, in .bss), so the buffers never fragment the heap. There is no
+// free(): the arena is reset as a whole, or rewound to a mark (e.g. the buffers of the previous picture are dropped
+// when the next picture is loaded).
+// allocate() returns nullptr when the arena is full: the owners declare their needs with a static arenaSize()
+// function, from which the arena is sized at compile time.
+class Arena {
+private:
+    uint8_t *buffer;
+    size_t size;
+    size_t used;
+    size_t peak;
+    uint32_t failures;
+
+public:
+    // Every allocation is rounded up to the strictest alignment of the platform, so that all the buffers are aligned
+    // for any type (e.g. the pointer tables on a 64-bit host), whatever the order of the allocations
+    static const size_t ALIGNMENT = alignof(std::max_align_t);
+
+    // Bytes taken by count items of type T, including the alignment padding
+    template<typename T>
+    static constexpr size_t bytes(size_t count) {
+        return (count * sizeof(T) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    Arena() : Arena(nullptr, 0) {}
+
+    Arena(uint8_t *_buffer, size_t _size) : buffer(_buffer), size(_size), used(0), peak(0), failures(0) {}
+
+    // Memory for count items of type T, zero-filled, nullptr if the arena is full
+    template<typename T>
+    T *allocate(size_t count) {
+        size_t length = bytes<T>(count);
+        if ( length > size - used ) {
+            failures++;
+            Serial.printf("Arena full: %u bytes requested, %u left\n", (uint)length, (uint)(size - used));
+            return nullptr;
+        }
+
+        uint8_t *memory = buffer + used;
+        used += length;
+        peak = used > peak ? used : peak;
+        memset(memory, 0, length);
+        return (T *)memory;
+    }
+
+    // A part of this arena, to be used (and reset) separately, empty if the arena is full
+    Arena allocateArena(size_t length) {
+        uint8_t *memory = allocate<uint8_t>(length);
+        return memory ? Arena(memory, bytes<uint8_t>(length)) : Arena();
+    }
+
+    size_t mark() const {
+        return used;
+    }
+
+    // Drop everything allocated since mark() returned this value
+    void rewind(size_t _mark) {
+        if ( _mark < used ) {
+            used = _mark;
+        }
+    }
+
+    void reset() {
+        used = 0;
+    }
+
+    size_t getSize() const {
+        return size;
+    }
+
+    size_t getUsed() const {
+        return used;
+    }
+
+    size_t getPeak() const {
+        return peak;
+    }
+
+    uint32_t getFailures() const {
+        return failures;
+    }
+};
+
+// Arena with its memory reserved statically
+template<size_t SIZE>
+class StaticArena : public Arena {
+private:
+    alignas(Arena::ALIGNMENT) uint8_t storage[SIZE > 0 ? SIZE : 1];
+
+public:
+    StaticArena() : Arena(storage, SIZE) {}
+};
+
+#endif
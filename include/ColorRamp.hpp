@@ -0,0 +1,26 @@
+#ifndef COLORRAMP_HPP
+#define COLORRAMP_HPP
+
+#include <FastLED.h>
+
+// Batched HSV -> RGB conversion for a row of pixels sharing the same hue and saturation (e.g. a gradient of a single
+// color). The hue and saturation part of hsv2rgb_rainbow is computed once for the whole row, only the value scaling
+// is done per pixel. The result is identical to converting each CHSV(hue, sat, values[i]) separately.
+inline void hsvValuesToRgb(uint8_t hue, uint8_t sat, const uint8_t *values, CRGB *dst, uint count) {
+    CRGB full;
+    hsv2rgb_rainbow(CHSV(hue, sat, 255), full);
+
+    for ( uint i = 0; i < count; i++ ) {
+        uint8_t val = values[i];
+
+        if ( val == 255 ) {
+            dst[i] = full;
+        }
+        else {
+            val = scale8_video(val, val);
+            dst[i] = CRGB( scale8(full.r, val), scale8(full.g, val), scale8(full.b, val) );
+        }
+    }
+}
+
+#endif
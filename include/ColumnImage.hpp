@@ -0,0 +1,178 @@
+#ifndef COLUMNIMAGE_HPP
+#define COLUMNIMAGE_HPP
+
+#include <FastLED.h>
+
+#include <FS.h>
+
+// Reader for the precompiled .lci picture format (see tools/img2lci.py).
+//
+// The pixels are stored column-major, in the order in which the picture scrolls, so that they can be decoded with
+// large sequential reads. All values are little-endian.
+//
+// Header (16 bytes):
+//   0  "LCI1"
+//   4  uint16 width
+//   6  uint16 height
+//   8  uint8  encoding: 0 = raw RGB, 1 = palette + RLE
+//   9  uint8  number of palette entries - 1 (palette encoding only)
+//   10 uint16 reserved
+//   12 uint32 offset of the pixel data
+// Palette (palette encoding only): RGB triplets, starting at byte 16.
+// Pixel data: column after column, row 0 is the bottom row of the picture (same as the BMP files).
+//   Raw encoding: one RGB triplet per pixel.
+//   Palette encoding: palette indices, RLE compressed. A control byte n < 128 is followed by one index repeated
+//   n+1 times, a control byte n >= 128 is followed by n-127 literal indices. Runs can span several columns.
+class ColumnImage {
+public:
+    static const uint8_t ENCODING_RAW = 0;
+    static const uint8_t ENCODING_PALETTE_RLE = 1;
+
+private:
+    static const uint HEADER_SIZE = 16;
+    static const uint READ_BUFFER_SIZE = 128;
+
+    fs::File file;
+
+    uint width;
+    uint height;
+    uint8_t encoding;
+    uint32_t data_location;
+    // Fixed size, so that loading pictures with different palettes does not allocate
+    CRGB palette[256];
+    uint palette_size;
+
+    // Next column that will be decoded
+    uint next_column;
+
+    // Sequential read buffer
+    uint8_t read_buffer[READ_BUFFER_SIZE];
+    uint read_buffer_pos;
+    uint read_buffer_len;
+
+    // RLE decoder state
+    uint8_t rle_count;
+    bool rle_literal;
+    uint8_t rle_value;
+
+    uint8_t nextByte() {
+        if ( read_buffer_pos >= read_buffer_len ) {
+            read_buffer_len = file.read(read_buffer, READ_BUFFER_SIZE);
+            read_buffer_pos = 0;
+
+            if ( read_buffer_len == 0 ) {
+                return 0;
+            }
+        }
+        return read_buffer[read_buffer_pos++];
+    }
+
+    CRGB nextPixel() {
+        if ( encoding == ENCODING_RAW ) {
+            uint8_t r = nextByte();
+            uint8_t g = nextByte();
+            uint8_t b = nextByte();
+            return CRGB(r, g, b);
+        }
+
+        if ( rle_count == 0 ) {
+            uint8_t control = nextByte();
+            if ( control < 128 ) {
+                rle_literal = false;
+                rle_count = control + 1;
+                rle_value = nextByte();
+            }
+            else {
+                rle_literal = true;
+                rle_count = control - 127;
+            }
+        }
+
+        rle_count--;
+        uint8_t index = rle_literal ? nextByte() : rle_value;
+        return index < palette_size ? palette[index] : CRGB(CRGB::Black);
+    }
+
+public:
+    ColumnImage() : width(0), height(0), encoding(ENCODING_RAW), data_location(0), palette_size(0), next_column(0),
+                    read_buffer_pos(0), read_buffer_len(0), rle_count(0), rle_literal(false), rle_value(0) {}
+
+    // Read the header and palette, returns false if the file is not a valid .lci picture
+    bool begin(fs::File _file) {
+        file = _file;
+        width = 0;
+        height = 0;
+
+        uint8_t header[HEADER_SIZE];
+        if ( !file || file.read(header, HEADER_SIZE) != HEADER_SIZE || memcmp(header, "LCI1", 4) != 0 ) {
+            return false;
+        }
+
+        width = header[4] | (header[5] << 8);
+        height = header[6] | (header[7] << 8);
+        encoding = header[8];
+        data_location = header[12] | (header[13] << 8) | ((uint32_t)header[14] << 16) | ((uint32_t)header[15] << 24);
+
+        palette_size = 0;
+        if ( encoding == ENCODING_PALETTE_RLE ) {
+            palette_size = header[9] + 1;
+            file.read((uint8_t *)palette, palette_size * 3);
+        }
+        else if ( encoding != ENCODING_RAW ) {
+            return false;
+        }
+
+        rewind();
+        return true;
+    }
+
+    void close() {
+        file.close();
+        width = 0;
+        height = 0;
+    }
+
+    uint getWidth() const {
+        return width;
+    }
+
+    uint getHeight() const {
+        return height;
+    }
+
+    uint getNextColumn() const {
+        return next_column;
+    }
+
+    // Restart decoding at the first column
+    void rewind() {
+        file.seek(data_location, SeekSet);
+        next_column = 0;
+        read_buffer_pos = 0;
+        read_buffer_len = 0;
+        rle_count = 0;
+    }
+
+    // Decode the next column into column[0..rows), rows that are not in the picture are set to black
+    void readColumn(CRGB *column, uint rows) {
+        for ( uint row = 0; row < height; row++ ) {
+            CRGB pixel = nextPixel();
+            if ( row < rows ) {
+                column[row] = pixel;
+            }
+        }
+        for ( uint row = height; row < rows; row++ ) {
+            column[row] = CRGB::Black;
+        }
+        next_column++;
+    }
+
+    void skipColumn() {
+        for ( uint row = 0; row < height; row++ ) {
+            nextPixel();
+        }
+        next_column++;
+    }
+};
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef COMPOSITOR_HPP
+#define COMPOSITOR_HPP
+
+#include <FastLED.h>
+#include <string.h>
+#include <algorithm>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "LedLayout.hpp"
+
+// How the color of a layer is combined with the pixel below it, in proportion of the alpha of the layer
+enum BlendMode : uint8_t {
+    BLEND_REPLACE, // The layer color, wherever its alpha is not 0
+    BLEND_ADD,     // Saturated sum
+    BLEND_MAX,     // Brightest channels
+    BLEND_ALPHA    // Linear blend
+};
+
+// Stack of overlays drawn over the frame of the base animation (e.g. sparkles, fade to black, crossfade).
+// The layers are stored by value in a tuple and called through templates, like the animations of AnimationRegistry,
+// and all the layers are blended in a single pass over the LEDs.
+//
+// The animations keep their state in the frame (some of them only redraw what changed), so the result is written to
+// a separate output buffer. When no layer is visible in a frame, there is no pass at all and the output is the frame.
+//
+// Each layer must provide:
+//   static constexpr BlendMode DEFAULT_BLEND_MODE
+//   bool beginFrame(uint framerate)                -- false if the layer is fully transparent in this frame
+//   uint8_t sample(uint led, CRGB &color)          -- alpha of the layer at this LED (0: transparent), and its color
+template<typename... Layers>
+class Compositor {
+private:
+    const CRGB *frame;
+    CRGB *output;
+    uint count;
+    std::tuple<Layers...> layers;
+    BlendMode blend_modes[sizeof...(Layers)];
+    bool visible[sizeof...(Layers)];
+
+    static void blend(BlendMode mode, CRGB &pixel, const CRGB &color, uint8_t alpha) {
+        // 0-256, so that an opaque layer replaces the pixel
+        uint weight = alpha + (alpha >> 7);
+
+        switch ( mode ) {
+            case BLEND_REPLACE:
+                pixel = color;
+                break;
+
+            case BLEND_ADD:
+                pixel.r = qadd8(pixel.r, (color.r * weight) >> 8);
+                pixel.g = qadd8(pixel.g, (color.g * weight) >> 8);
+                pixel.b = qadd8(pixel.b, (color.b * weight) >> 8);
+                break;
+
+            case BLEND_MAX:
+                pixel.r = std::max<uint8_t>(pixel.r, (color.r * weight) >> 8);
+                pixel.g = std::max<uint8_t>(pixel.g, (color.g * weight) >> 8);
+                pixel.b = std::max<uint8_t>(pixel.b, (color.b * weight) >> 8);
+                break;
+
+            case BLEND_ALPHA: {
+                uint keep = 256 - weight;
+                pixel.r = (pixel.r * keep + color.r * weight) >> 8;
+                pixel.g = (pixel.g * keep + color.g * weight) >> 8;
+                pixel.b = (pixel.b * keep + color.b * weight) >> 8;
+                break;
+            }
+        }
+    }
+
+    template<size_t I>
+    void blendLayer(uint led, CRGB &pixel) {
+        if ( visible[I] ) {
+            CRGB color;
+            uint8_t alpha = std::get<I>(layers).sample(led, color);
+            if ( alpha ) {
+                blend(blend_modes[I], pixel, color, alpha);
+            }
+        }
+    }
+
+    template<size_t... I>
+    bool beginFrame(uint framerate, std::index_sequence<I...>) {
+        ( (visible[I] = std::get<I>(layers).beginFrame(framerate)), ... );
+        return ( visible[I] || ... || false );
+    }
+
+    template<typename Layer, size_t... I>
+    static constexpr size_t indexOf(std::index_sequence<I...>) {
+        return ( (std::is_same<Layer, Layers>::value ? I : 0) + ... + 0 );
+    }
+
+    // Single pass: each LED goes through all the visible layers, from the first to the last one
+    template<size_t... I>
+    void composite(std::index_sequence<I...>) {
+        for ( uint led = 0; led < count; led++ ) {
+            CRGB pixel = frame[led];
+            ( blendLayer<I>(led, pixel), ... );
+            output[led] = pixel;
+        }
+    }
+
+public:
+    // frame and output have count LEDs
+    Compositor(const CRGB *_frame, CRGB *_output, uint _count, Layers... _layers) : frame(_frame), output(_output),
+            count(_count), layers(std::move(_layers)...), blend_modes{ Layers::DEFAULT_BLEND_MODE... } {
+        memset(visible, 0, sizeof(visible));
+    }
+
+    // Blend the visible layers over the frame, once per rendered frame. Returns the LEDs to show: the frame itself
+    // when all the layers are transparent, else the output buffer.
+    const CRGB *compose(uint framerate) {
+        if ( !beginFrame(framerate, std::index_sequence_for<Layers...>()) ) {
+            return frame;
+        }
+        composite(std::index_sequence_for<Layers...>());
+        return output;
+    }
+
+    template<typename Layer>
+    Layer &get() {
+        return std::get<Layer>(layers);
+    }
+
+    template<typename Layer>
+    void setBlendMode(BlendMode mode) {
+        blend_modes[indexOf<Layer>(std::index_sequence_for<Layers...>())] = mode;
+    }
+};
+
+// White sparkles lit at random LEDs of the matrix, for one frame. The density is the probability that a LED lights up
+// during one second (65536 = 1), so that it does not depend on the frame rate. Uses random16(): synchronized nodes
+// (see FrameSync) show the same sparkles.
+class SparkleLayer {
+private:
+    const uint16_t *inverse_map; // Matrix position of each LED, in flash (see LedInverseMap)
+    uint32_t density;
+    uint16_t threshold; // random16() below this value lights a sparkle in this frame
+
+public:
+    static constexpr BlendMode DEFAULT_BLEND_MODE = BLEND_REPLACE;
+
+    // The LEDs outside the matrix (LED_NOT_MAPPED in inverse_map) never sparkle
+    SparkleLayer(const uint16_t *_inverse_map, uint32_t _density = 0) : inverse_map(_inverse_map), density(_density),
+            threshold(0) {}
+
+    void setDensity(uint32_t _density) {
+        density = _density;
+    }
+
+    bool beginFrame(uint framerate) {
+        threshold = density / framerate;
+        return threshold > 0;
+    }
+
+    uint8_t sample(uint led, CRGB &color) {
+        if ( pgm_read_word(&inverse_map[led]) != LED_NOT_MAPPED && random16() < threshold ) {
+            color = CRGB::White;
+            return 255;
+        }
+        return 0;
+    }
+};
+
+// Uniform color (black: fade out) with an alpha that moves towards a target over a number of frames
+class FadeLayer {
+private:
+    CRGB color;
+    uint16_t level; // Alpha * 256
+    uint16_t target;
+    uint16_t step;
+
+public:
+    static constexpr BlendMode DEFAULT_BLEND_MODE = BLEND_ALPHA;
+
+    FadeLayer(const CRGB &_color = CRGB::Black) : color(_color), level(0), target(0), step(0) {}
+
+    // Reach alpha in the given number of frames (0: at once)
+    void fadeTo(uint8_t alpha, uint frames) {
+        target = alpha << 8;
+        uint distance = target > level ? target - level : level - target;
+        step = frames ? std::max<uint>(1, distance / frames) : distance;
+    }
+
+    uint8_t getAlpha() const {
+        return level >> 8;
+    }
+
+    // The fade is over
+    bool isDone() const {
+        return level == target;
+    }
+
+    bool beginFrame(uint framerate) {
+        if ( level < target ) {
+            level = target - level > step ? level + step : target;
+        }
+        else if ( level > target ) {
+            level = level - target > step ? level - step : target;
+        }
+        return level >= 256;
+    }
+
+    uint8_t sample(uint led, CRGB &result) {
+        result = color;
+        return level >> 8;
+    }
+};
+
+// Copy of a previous frame, fading out over the new frames (transition between two animations)
+class CrossfadeLayer {
+private:
+    CRGB *snapshot;
+    uint count;
+    FadeLayer fade;
+
+public:
+    static constexpr BlendMode DEFAULT_BLEND_MODE = BLEND_ALPHA;
+
+    // snapshot has count LEDs
+    CrossfadeLayer(CRGB *_snapshot, uint _count) : snapshot(_snapshot), count(_count) {}
+
+    // Start from the LEDs that are shown now, they disappear in the given number of frames
+    void start(const CRGB *leds, uint frames) {
+        if ( leds != snapshot ) {
+            memcpy(snapshot, leds, count * sizeof(CRGB));
+        }
+        fade.fadeTo(255, 0);
+        fade.beginFrame(0);
+        fade.fadeTo(0, frames);
+    }
+
+    bool isDone() const {
+        return fade.isDone();
+    }
+
+    bool beginFrame(uint framerate) {
+        return fade.beginFrame(framerate);
+    }
+
+    uint8_t sample(uint led, CRGB &color) {
+        color = snapshot[led];
+        return fade.getAlpha();
+    }
+};
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef DDPRECEIVER_HPP
+#define DDPRECEIVER_HPP
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include <WiFiUdp.h>
+
+// Receiver of realtime pixel data sent over UDP with the Distributed Display Protocol (DDP, http://www.3waylabs.com/ddp/),
+// as sent by xLights, WLED, LedFx... The payload is read from the UDP packet straight into the LEDs:
+//  - raw mode: the data offset is a byte offset in leds[]
+//  - matrix mode: the data offset is a byte offset in the matrix (row-major RGB pixels), each pixel is written to its
+//    LED through the ledmap
+// A frame is complete when a packet has the PUSH flag. The sender is considered gone when no packet has been received
+// for timeout_ms, the local animations can then take over again.
+//
+// Packet header (10 bytes, followed by a 4 bytes timecode if the TIMECODE flag is set):
+//   flags (version 1 in bits 7-6), sequence number (1-15 in the low nibble, 0 if unused), data type, destination ID,
+//   data offset (32 bits big endian), data length (16 bits big endian)
+#ifndef DDP_PORT
+#define DDP_PORT 4048
+#endif
+
+class DdpReceiver {
+private:
+    static const uint8_t FLAG_VERSION_MASK = 0xC0;
+    static const uint8_t FLAG_VERSION_1 = 0x40;
+    static const uint8_t FLAG_TIMECODE = 0x10;
+    static const uint8_t FLAG_STORAGE = 0x08;
+    static const uint8_t FLAG_REPLY = 0x04;
+    static const uint8_t FLAG_QUERY = 0x02;
+    static const uint8_t FLAG_PUSH = 0x01;
+
+    static const uint8_t ID_DISPLAY = 1;
+    static const uint8_t ID_ALL = 255;
+
+    static const uint HEADER_SIZE = 10;
+    static const uint TIMECODE_SIZE = 4;
+
+    // Bounds the time spent in poll() when packets arrive faster than they are processed
+    static const uint MAX_PACKETS_PER_POLL = 16;
+
+    WiFiUDP udp;
+
+    CRGB *leds;
+    uint num_leds;
+
+    // Matrix position -> LED index (in flash), nullptr in raw mode
+    const uint16_t *map;
+    uint map_size;
+
+    unsigned long timeout_ms;
+    unsigned long last_packet_ms;
+    bool active;
+
+    uint8_t last_sequence;
+    uint32_t packets;
+    uint32_t frames;
+    uint32_t lost_packets;
+    uint32_t rejected_packets;
+
+    static uint32_t readBigEndian(const uint8_t *bytes, uint size) {
+        uint32_t value = 0;
+        for ( uint i = 0; i < size; i++ ) {
+            value = (value << 8) | bytes[i];
+        }
+        return value;
+    }
+
+    void countLostPackets(uint8_t sequence) {
+        if ( sequence != 0 && last_sequence != 0 ) {
+            uint8_t expected = last_sequence % 15 + 1;
+            lost_packets += (sequence + 15 - expected) % 15;
+        }
+        last_sequence = sequence;
+    }
+
+    // Payload bytes [offset, offset + length) of the LED buffer
+    void readRaw(uint32_t offset, uint length) {
+        uint size = num_leds * sizeof(CRGB);
+        if ( offset >= size ) {
+            return;
+        }
+        if ( length > size - offset ) {
+            length = size - offset;
+        }
+        udp.read((uint8_t *)leds + offset, length);
+    }
+
+    // Payload bytes [offset, offset + length) of the matrix, whole pixels are read straight into their LED
+    void readMapped(uint32_t offset, uint length) {
+        uint size = map_size * sizeof(CRGB);
+        if ( offset >= size ) {
+            return;
+        }
+        uint32_t end = length > size - offset ? size : offset + length;
+
+        CRGB discard;
+        for ( uint32_t position = offset; position < end; ) {
+            uint16_t led = pgm_read_word(&map[position / 3]);
+            uint8_t *pixel = led < num_leds ? leds[led].raw : discard.raw;
+            uint channel = position % 3;
+
+            if ( channel == 0 && end - position >= 3 ) {
+                udp.read(pixel, 3);
+                position += 3;
+            }
+            else {
+                // Pixel split between two packets
+                pixel[channel] = udp.read();
+                position++;
+            }
+        }
+    }
+
+    // Returns true if the packet completes a frame
+    bool readPacket(uint size, unsigned long now_ms) {
+        uint8_t header[HEADER_SIZE];
+        if ( size < HEADER_SIZE || udp.read(header, HEADER_SIZE) != (int)HEADER_SIZE ) {
+            rejected_packets++;
+            return false;
+        }
+
+        uint8_t flags = header[0];
+        uint8_t id = header[3];
+        if ( (flags & FLAG_VERSION_MASK) != FLAG_VERSION_1 || (flags & (FLAG_QUERY | FLAG_REPLY | FLAG_STORAGE))
+                || (id != ID_DISPLAY && id != ID_ALL) ) {
+            // Not for us, or not pixel data
+            rejected_packets++;
+            return false;
+        }
+
+        if ( flags & FLAG_TIMECODE ) {
+            uint8_t timecode[TIMECODE_SIZE];
+            udp.read(timecode, TIMECODE_SIZE);
+        }
+
+        packets++;
+        last_packet_ms = now_ms;
+        active = true;
+        countLostPackets(header[1] & 0x0F);
+
+        uint32_t offset = readBigEndian(header + 4, 4);
+        uint length = readBigEndian(header + 8, 2);
+        if ( length > (uint)udp.available() ) {
+            length = udp.available();
+        }
+
+        if ( map ) {
+            readMapped(offset, length);
+        }
+        else {
+            readRaw(offset, length);
+        }
+
+        if ( flags & FLAG_PUSH ) {
+            frames++;
+            return true;
+        }
+        return false;
+    }
+
+public:
+    // Raw mode, the offsets are in leds[]
+    DdpReceiver(CRGB *_leds, uint _num_leds, unsigned long _timeout_ms = 2500)
+        : DdpReceiver(_leds, _num_leds, nullptr, 0, _timeout_ms) {}
+
+    // Matrix mode, the offsets are in the matrix, map is a row-major ledmap in flash
+    DdpReceiver(CRGB *_leds, uint _num_leds, const uint16_t *_map, uint _map_size, unsigned long _timeout_ms = 2500)
+        : leds(_leds), num_leds(_num_leds), map(_map), map_size(_map_size), timeout_ms(_timeout_ms),
+          last_packet_ms(0), active(false), last_sequence(0), packets(0), frames(0), lost_packets(0), rejected_packets(0) {}
+
+    bool begin(uint16_t port = DDP_PORT) {
+        return udp.begin(port) == 1;
+    }
+
+    // Reads the waiting packets into the LEDs, returns true if a frame has been completed and must be shown
+    bool poll(unsigned long now_ms) {
+        bool frame_complete = false;
+
+        for ( uint count = 0; count < MAX_PACKETS_PER_POLL; count++ ) {
+            int size = udp.parsePacket();
+            if ( size <= 0 ) {
+                break;
+            }
+            // The unread bytes are dropped by the next parsePacket()
+            frame_complete |= readPacket(size, now_ms);
+        }
+
+        if ( active && now_ms - last_packet_ms > timeout_ms ) {
+            active = false;
+            last_sequence = 0;
+        }
+        return frame_complete;
+    }
+
+    // True while a sender is streaming
+    bool isActive() const {
+        return active;
+    }
+
+    uint32_t getPackets() const {
+        return packets;
+    }
+
+    uint32_t getFrames() const {
+        return frames;
+    }
+
+    uint32_t getLostPackets() const {
+        return lost_packets;
+    }
+
+    uint32_t getRejectedPackets() const {
+        return rejected_packets;
+    }
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef FASTRANDOM_HPP
+#define FASTRANDOM_HPP
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// xorshift32 pseudo random generator (Marsaglia), 3 shifts and 3 xors per 32 bit word.
+// Meant for filling a whole row of random numbers at once in the animations, where calling random8()/random16()
+// for each pixel costs more than the rest of the rendering. Not suitable for anything but visual effects.
+class FastRandom {
+private:
+    uint32_t state;
+
+public:
+    FastRandom(uint32_t seed = 2463534242u) {
+        setSeed(seed);
+    }
+
+    // The state must not be 0
+    void setSeed(uint32_t seed) {
+        state = seed ? seed : 2463534242u;
+    }
+
+    uint32_t next() {
+        uint32_t x = state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        state = x;
+        return x;
+    }
+
+    // Hash of 2 numbers (murmur3 finalizer), e.g. to derive the seed of a frame from a shared seed and the frame number
+    static uint32_t mix(uint32_t a, uint32_t b) {
+        uint32_t h = a ^ (b * 0x9E3779B9u);
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+        h *= 0xC2B2AE35u;
+        h ^= h >> 16;
+        return h;
+    }
+
+    void fill(uint32_t *dst, uint count) {
+        uint32_t x = state;
+        for ( uint i = 0; i < count; i++ ) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            dst[i] = x;
+        }
+        state = x;
+    }
+};
+
+#endif
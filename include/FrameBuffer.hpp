@@ -0,0 +1,132 @@
+#ifndef FRAMEBUFFER_HPP
+#define FRAMEBUFFER_HPP
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include <string.h>
+
+#include "LedGeometry.hpp"
+#include "LedLayout.hpp"
+
+// Contiguous, row-major LED matrix that the animations render into.
+//
+// Two modes are available:
+// - Plain buffer: pixel (row, col) is stored at pixels[row * stride + col].
+// - Render-through: pixel (row, col) is stored at pixels[ map[row * cols + col] ]. With pixels pointing to the
+//   leds[] array and map pointing to the ledmap, the animations write straight into the LED strip buffer and
+//   no separate clear/remap pass is needed before FastLED.show(). The map can be stored in flash (PROGMEM), it is
+//   read with pgm_read_word().
+//
+// In render-through mode, the frame buffer can also give the position of every LED of pixels (see LedGeometry.hpp),
+// for the animations computed from the coordinates.
+class FrameBuffer {
+private:
+    CRGB *pixels;
+    const uint16_t *map;
+    uint rows;
+    uint cols;
+    uint stride;
+    const LedPoint *points;
+    uint n_leds;
+
+public:
+    FrameBuffer(CRGB *_pixels, uint _rows, uint _cols, uint _stride) : pixels(_pixels), map(nullptr), rows(_rows), cols(_cols), stride(_stride),
+        points(nullptr), n_leds(0) {}
+
+    FrameBuffer(CRGB *_pixels, uint _rows, uint _cols) : FrameBuffer(_pixels, _rows, _cols, _cols) {}
+
+    FrameBuffer(CRGB *_pixels, const uint16_t *_map, uint _rows, uint _cols) : pixels(_pixels), map(_map), rows(_rows), cols(_cols), stride(_cols),
+        points(nullptr), n_leds(0) {}
+
+    // Render-through with the position of the _n_leds LEDs of pixels
+    FrameBuffer(CRGB *_pixels, const uint16_t *_map, uint _rows, uint _cols, const LedPoint *_points, uint _n_leds)
+        : pixels(_pixels), map(_map), rows(_rows), cols(_cols), stride(_cols), points(_points), n_leds(_n_leds) {}
+
+    uint getRows() const {
+        return rows;
+    }
+
+    uint getCols() const {
+        return cols;
+    }
+
+    bool isMapped() const {
+        return map != nullptr;
+    }
+
+    bool hasGeometry() const {
+        return points != nullptr;
+    }
+
+    // LEDs with a position, in the order of the strip
+    uint getLedCount() const {
+        return n_leds;
+    }
+
+    const LedPoint *getPoints() const {
+        return points;
+    }
+
+    CRGB *getLeds() {
+        return pixels;
+    }
+
+    CRGB &at(uint row, uint col) {
+        uint index = row * stride + col;
+        return map ? pixels[ pgm_read_word(&map[index]) ] : pixels[index];
+    }
+
+    const CRGB &at(uint row, uint col) const {
+        uint index = row * stride + col;
+        return map ? pixels[ pgm_read_word(&map[index]) ] : pixels[index];
+    }
+
+    // Copy count pixels into a row, starting at column col
+    void copyToRow(uint row, uint col, const CRGB *src, uint count) {
+        if ( map ) {
+            const uint16_t *row_map = map + row * stride + col;
+            for ( uint i = 0; i < count; i++ ) {
+                pixels[ pgm_read_word(&row_map[i]) ] = src[i];
+            }
+        }
+        else {
+            memcpy( &pixels[row * stride + col], src, count * sizeof(CRGB) );
+        }
+    }
+
+    // Fill count pixels of a row, starting at column col
+    void fillRow(uint row, uint col, uint count, const CRGB &color) {
+        if ( map ) {
+            const uint16_t *row_map = map + row * stride + col;
+            for ( uint i = 0; i < count; i++ ) {
+                pixels[ pgm_read_word(&row_map[i]) ] = color;
+            }
+        }
+        else {
+            fill_solid( &pixels[row * stride + col], count, color );
+        }
+    }
+
+    void fillRow(uint row, const CRGB &color) {
+        fillRow(row, 0, cols, color);
+    }
+
+    // Black for the LEDs with a position that are not in the matrix (inverse_map: matrix position of each LED, in
+    // flash, see LedInverseMap). Only the animations that use the positions draw them: they must be cleared when
+    // another animation is selected.
+    void clearOutsideMatrix(const uint16_t *inverse_map) {
+        for ( uint led = 0; led < n_leds; led++ ) {
+            if ( pgm_read_word(&inverse_map[led]) == LED_NOT_MAPPED ) {
+                pixels[led] = CRGB::Black;
+            }
+        }
+    }
+
+    void fill(const CRGB &color) {
+        for ( uint row = 0; row < rows; row++ ) {
+            fillRow(row, color);
+        }
+    }
+};
+
+#endif
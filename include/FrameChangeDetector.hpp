@@ -0,0 +1,61 @@
+#ifndef FRAMECHANGEDETECTOR_HPP
+#define FRAMECHANGEDETECTOR_HPP
+
+#include <FastLED.h>
+
+// Detects frames that are identical to the previously shown one, so that FastLED.show() (which keeps the interrupts
+// disabled for ~30us per LED) can be skipped. Only a hash of the last frame is kept, no copy of the LEDs.
+// A frame is still sent at least every max_age_ms, so that a glitch on the data line does not stay visible.
+class FrameChangeDetector {
+private:
+    uint32_t last_hash;
+    uint8_t last_brightness;
+    bool valid;
+    unsigned long max_age_ms;
+    unsigned long last_show_ms;
+
+public:
+    FrameChangeDetector(unsigned long _max_age_ms = 1000) : last_hash(0), last_brightness(0), valid(false), max_age_ms(_max_age_ms), last_show_ms(0) {}
+
+    // One step of the frame hash, per LED
+    static uint32_t hashStep(uint32_t h, const CRGB &led) {
+        h = (h ^ (led.r | (led.g << 8) | ((uint32_t)led.b << 16))) * 16777619u;
+        return h ^ (h >> 15);
+    }
+
+    static const uint32_t HASH_SEED = 2166136261u;
+
+    // 32 bit hash of the LEDs
+    static uint32_t hash(const CRGB *leds, uint count) {
+        uint32_t h = HASH_SEED;
+        for ( uint i = 0; i < count; i++ ) {
+            h = hashStep(h, leds[i]);
+        }
+        return h;
+    }
+
+    // Returns true if the frame must be shown, and then records it as the last shown frame
+    bool changed(const CRGB *leds, uint count, uint8_t brightness, unsigned long now_ms) {
+        return changed(hash(leds, count), brightness, now_ms);
+    }
+
+    // Same, with the hash of the frame already computed (e.g. by PowerLimiter::scan())
+    bool changed(uint32_t h, uint8_t brightness, unsigned long now_ms) {
+        if ( valid && h == last_hash && brightness == last_brightness && now_ms - last_show_ms < max_age_ms ) {
+            return false;
+        }
+
+        last_hash = h;
+        last_brightness = brightness;
+        last_show_ms = now_ms;
+        valid = true;
+        return true;
+    }
+
+    // The next frame will be shown in any case
+    void invalidate() {
+        valid = false;
+    }
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef FRAMEPROFILER_HPP
+#define FRAMEPROFILER_HPP
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <algorithm>
+
+// Measures the time spent in each stage of the main loop.
+// The durations of the last N_SAMPLES frames are kept in a ring buffer per stage (fixed memory, nothing allocated),
+// min/avg/p99/max are only computed when the statistics are requested.
+//
+// Usage in loop(): beginFrame(), then mark(stage) at the end of each stage, then endFrame(). The stages can be spread
+// over several loop() iterations, skip() excludes the idle time between them. The frame time is the sum of the stages.
+template<uint N_STAGES, uint N_SAMPLES = 128>
+class FrameProfiler {
+public:
+    struct Stats {
+        uint32_t min;
+        uint32_t avg;
+        uint32_t p99;
+        uint32_t max;
+    };
+
+private:
+    const char *const *stage_names;
+
+    // Durations in microseconds, saturated at 65535us. The last row is the complete frame.
+    uint16_t samples[N_STAGES + 1][N_SAMPLES];
+    uint sample_index;
+    uint sample_count;
+
+    unsigned long stage_start_us;
+    uint16_t current[N_STAGES + 1];
+
+    uint32_t frames;
+    uint32_t missed_deadlines;
+
+    static uint16_t saturate(unsigned long duration) {
+        return duration > 0xFFFF ? 0xFFFF : duration;
+    }
+
+public:
+    FrameProfiler(const char *const *_stage_names) : stage_names(_stage_names) {
+        reset();
+    }
+
+    void reset() {
+        sample_index = 0;
+        sample_count = 0;
+        frames = 0;
+        missed_deadlines = 0;
+        beginFrame();
+    }
+
+    void beginFrame() {
+        stage_start_us = micros();
+        std::fill(&current[0], &current[N_STAGES + 1], 0);
+    }
+
+    // End of a stage, the time since the previous mark (or the beginning of the frame) is added to this stage
+    void mark(uint stage) {
+        unsigned long now = micros();
+        current[stage] = saturate(current[stage] + (now - stage_start_us));
+        stage_start_us = now;
+    }
+
+    // Time that must not be accounted to any stage (e.g. waiting for the next frame)
+    void skip() {
+        stage_start_us = micros();
+    }
+
+    // missed: number of frame deadlines missed since the previous frame
+    void endFrame(uint missed) {
+        unsigned long frame_duration = 0;
+        for ( uint stage = 0; stage < N_STAGES; stage++ ) {
+            frame_duration += current[stage];
+        }
+        current[N_STAGES] = saturate(frame_duration);
+
+        for ( uint stage = 0; stage < N_STAGES + 1; stage++ ) {
+            samples[stage][sample_index] = current[stage];
+        }
+        sample_index = (sample_index + 1) % N_SAMPLES;
+        sample_count = std::min(sample_count + 1, N_SAMPLES);
+
+        frames++;
+        missed_deadlines += missed;
+    }
+
+    uint32_t getFrames() const {
+        return frames;
+    }
+
+    uint32_t getMissedDeadlines() const {
+        return missed_deadlines;
+    }
+
+    // Statistics over the last frames, stage N_STAGES is the complete frame
+    Stats getStats(uint stage) const {
+        Stats stats = { 0, 0, 0, 0 };
+        if ( sample_count == 0 ) {
+            return stats;
+        }
+
+        uint16_t sorted[N_SAMPLES];
+        std::copy(&samples[stage][0], &samples[stage][sample_count], sorted);
+        std::sort(sorted, sorted + sample_count);
+
+        uint32_t sum = 0;
+        for ( uint i = 0; i < sample_count; i++ ) {
+            sum += sorted[i];
+        }
+
+        stats.min = sorted[0];
+        stats.avg = sum / sample_count;
+        stats.p99 = sorted[ (sample_count * 99 + 99) / 100 - 1 ];
+        stats.max = sorted[sample_count - 1];
+        return stats;
+    }
+
+    // Human readable table (RemoteDebug), returns the length of the text
+    int formatText(char *buffer, size_t size) const {
+        int len = snprintf(buffer, size, "frames=%u missed=%u (last %u frames, us)\r\n%-10s %6s %6s %6s %6s\r\n",
+                           (unsigned)frames, (unsigned)missed_deadlines, sample_count, "stage", "min", "avg", "p99", "max");
+
+        for ( uint stage = 0; stage < N_STAGES + 1 && len < (int)size; stage++ ) {
+            Stats stats = getStats(stage);
+            len += snprintf(buffer + len, size - len, "%-10s %6u %6u %6u %6u\r\n",
+                            stage < N_STAGES ? stage_names[stage] : "frame",
+                            (unsigned)stats.min, (unsigned)stats.avg, (unsigned)stats.p99, (unsigned)stats.max);
+        }
+        return len;
+    }
+
+    // Compact JSON (MQTT): {"frames":N,"missed":N,"<stage>":[min,avg,p99,max],...}
+    int formatJson(char *buffer, size_t size) const {
+        int len = snprintf(buffer, size, "{\"frames\":%u,\"missed\":%u", (unsigned)frames, (unsigned)missed_deadlines);
+
+        for ( uint stage = 0; stage < N_STAGES + 1 && len < (int)size; stage++ ) {
+            Stats stats = getStats(stage);
+            len += snprintf(buffer + len, size - len, ",\"%s\":[%u,%u,%u,%u]",
+                            stage < N_STAGES ? stage_names[stage] : "frame",
+                            (unsigned)stats.min, (unsigned)stats.avg, (unsigned)stats.p99, (unsigned)stats.max);
+        }
+
+        if ( len < (int)size ) {
+            len += snprintf(buffer + len, size - len, "}");
+        }
+        return len;
+    }
+};
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef FRAMERECORDER_HPP
+#define FRAMERECORDER_HPP
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include "Arena.hpp"
+
+// Delta-compressed recording of the LED frames, to compare the output of the animations before and after a change
+// (see native/record) or to replay realistic frames in the benchmarks.
+// Each frame only stores the runs of LEDs that changed since the previous frame. Stream format (little endian):
+//   header: "LFR1", LED count (16 bits), matrix columns (16 bits, 0 if the LEDs are in the order of the strip)
+//   frame:  number of runs (16 bits), then for each run: first LED (16 bits), LED count (16 bits), count * r, g, b
+// The first frame is compared with black LEDs.
+// Timed streams ("LFR2", the frame animations played by MoviePlayer) start each frame with its duration in ms (16 bits).
+//
+// Output and Input are Arduino streams (File, Print...): size_t write(const uint8_t *, size_t) and
+// size_t read(uint8_t *, size_t).
+static const uint8_t FRAME_STREAM_MAGIC[4] = { 'L', 'F', 'R', '1' };
+static const uint8_t FRAME_STREAM_TIMED_MAGIC[4] = { 'L', 'F', 'R', '2' };
+
+class FrameRecorder {
+private:
+    // Unchanged LEDs that are cheaper to store than a new run header (4 bytes)
+    static const uint MAX_GAP = 1;
+
+    uint count;
+    CRGB *previous;
+    uint16_t *runs; // First LED and LED count of each run of the current frame
+    bool timed;
+    uint32_t frames;
+    size_t bytes;
+
+    template<typename Output>
+    void writeUint16(Output &out, uint16_t value) {
+        uint8_t data[2] = { (uint8_t)value, (uint8_t)(value >> 8) };
+        bytes += out.write(data, 2);
+    }
+
+public:
+    // Size of the buffers allocated in the arena
+    static constexpr size_t arenaSize(uint count) {
+        return Arena::bytes<CRGB>(count) + Arena::bytes<uint16_t>(count + 1);
+    }
+
+    FrameRecorder(Arena &arena, uint _count) : count(_count), timed(false), frames(0), bytes(0) {
+        previous = arena.allocate<CRGB>(count);
+        // A run is at least 1 LED followed by an unchanged one: at most (count + 1) / 2 runs of 2 numbers
+        runs = arena.allocate<uint16_t>(count + 1);
+    }
+
+    // Starts a new stream. cols: columns of the matrix if the LEDs are recorded in matrix order (row-major), else 0.
+    // _timed: the duration of each frame is stored
+    template<typename Output>
+    void begin(Output &out, uint cols = 0, bool _timed = false) {
+        memset((void *)previous, 0, count * sizeof(CRGB));
+        timed = _timed;
+        frames = 0;
+        bytes = out.write(timed ? FRAME_STREAM_TIMED_MAGIC : FRAME_STREAM_MAGIC, sizeof(FRAME_STREAM_MAGIC));
+        writeUint16(out, count);
+        writeUint16(out, cols);
+    }
+
+    // duration_ms is only stored in timed streams
+    template<typename Output>
+    void record(Output &out, const CRGB *leds, uint16_t duration_ms = 0) {
+        uint n_runs = 0;
+        uint index = 0;
+
+        while ( index < count ) {
+            if ( leds[index] == previous[index] ) {
+                index++;
+                continue;
+            }
+
+            // Extend the run over the changed LEDs and the short gaps between them
+            uint first = index;
+            uint last = index + 1;
+            for ( uint next = last; next < count && next <= last + MAX_GAP; next++ ) {
+                if ( leds[next] != previous[next] ) {
+                    last = next + 1;
+                }
+            }
+            runs[2 * n_runs] = first;
+            runs[2 * n_runs + 1] = last - first;
+            n_runs++;
+            index = last;
+        }
+
+        if ( timed ) {
+            writeUint16(out, duration_ms);
+        }
+        writeUint16(out, n_runs);
+        for ( uint run = 0; run < n_runs; run++ ) {
+            uint first = runs[2 * run];
+            uint length = runs[2 * run + 1];
+            writeUint16(out, first);
+            writeUint16(out, length);
+            for ( uint i = first; i < first + length; i++ ) {
+                bytes += out.write(leds[i].raw, 3);
+                previous[i] = leds[i];
+            }
+        }
+        frames++;
+    }
+
+    uint32_t getFrames() const {
+        return frames;
+    }
+
+    // Bytes written since begin(), header included
+    size_t getBytes() const {
+        return bytes;
+    }
+};
+
+// Reads a stream written by FrameRecorder into the LEDs, frame by frame
+class FrameReplayer {
+private:
+    CRGB *leds;
+    uint max_count;
+    uint count;
+    uint cols;
+    bool timed;
+    uint duration;
+    uint32_t frame;
+
+    template<typename Input>
+    bool readUint16(Input &in, uint &value) {
+        uint8_t data[2];
+        if ( in.read(data, 2) != 2 ) {
+            return false;
+        }
+        value = data[0] | (data[1] << 8);
+        return true;
+    }
+
+public:
+    // leds: room for max_count LEDs
+    FrameReplayer(CRGB *_leds, uint _max_count) : leds(_leds), max_count(_max_count), count(0), cols(0), timed(false),
+            duration(0), frame(0) {}
+
+    // Reads the header, returns false if this is not a frame stream or if it has more LEDs than max_count
+    template<typename Input>
+    bool begin(Input &in) {
+        uint8_t magic[sizeof(FRAME_STREAM_MAGIC)];
+        if ( in.read(magic, sizeof(magic)) != sizeof(magic) ) {
+            return false;
+        }
+        timed = memcmp(magic, FRAME_STREAM_TIMED_MAGIC, sizeof(magic)) == 0;
+        if ( (!timed && memcmp(magic, FRAME_STREAM_MAGIC, sizeof(magic)) != 0) || !readUint16(in, count)
+                || !readUint16(in, cols) || count > max_count ) {
+            return false;
+        }
+        memset((void *)leds, 0, count * sizeof(CRGB));
+        duration = 0;
+        frame = 0;
+        return true;
+    }
+
+    // Applies the next frame to the LEDs, returns false at the end of the stream (or if it is corrupted)
+    template<typename Input>
+    bool next(Input &in) {
+        uint n_runs;
+        if ( (timed && !readUint16(in, duration)) || !readUint16(in, n_runs) ) {
+            return false;
+        }
+
+        for ( uint run = 0; run < n_runs; run++ ) {
+            uint first;
+            uint length;
+            if ( !readUint16(in, first) || !readUint16(in, length) || first + length > count
+                    || in.read((uint8_t *)(leds + first), length * 3) != length * 3 ) {
+                return false;
+            }
+        }
+        frame++;
+        return true;
+    }
+
+    // LEDs per frame
+    uint getCount() const {
+        return count;
+    }
+
+    // Matrix columns if the LEDs were recorded in matrix order, else 0
+    uint getCols() const {
+        return cols;
+    }
+
+    // True if the frames have a duration
+    bool isTimed() const {
+        return timed;
+    }
+
+    // Duration of the last frame read in ms, 0 if the stream is not timed
+    uint getDuration() const {
+        return duration;
+    }
+
+    // Frames read so far
+    uint32_t getFrame() const {
+        return frame;
+    }
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef FRAMESCHEDULER_HPP
+#define FRAMESCHEDULER_HPP
+
+#include <Arduino.h>
+
+// Fixed timestep frame scheduler.
+// The frame deadlines are absolute (multiples of the frame period), so a late frame does not shift the following
+// ones. When the loop falls behind (slow network, picture loading...), the animation is advanced by several steps and
+// only the last one is rendered: rendering is skipped, not the animation timeline.
+class FrameScheduler {
+private:
+    unsigned long period_us;
+    unsigned long next_deadline_us;
+    uint max_catchup_steps;
+    uint32_t dropped_frames;
+
+public:
+    // After a stall longer than max_catchup_steps frames, the timeline restarts from now instead of catching up
+    FrameScheduler(uint framerate, uint _max_catchup_steps = 24) : max_catchup_steps(_max_catchup_steps), dropped_frames(0) {
+        period_us = 1000000 / framerate;
+        next_deadline_us = micros();
+    }
+
+    void setFramerate(uint framerate) {
+        unsigned long new_period_us = 1000000 / framerate;
+        if ( new_period_us != period_us ) {
+            // The next deadline is moved according to the new period
+            next_deadline_us = next_deadline_us - period_us + new_period_us;
+            period_us = new_period_us;
+        }
+    }
+
+    // Start a new timeline, the next frame is due now (e.g. when leaving the idle mode)
+    void restart() {
+        next_deadline_us = micros();
+    }
+
+    // Align the timeline on an external clock (see FrameSync): the next frame is due at deadline_us
+    void setNextDeadline(unsigned long deadline_us) {
+        next_deadline_us = deadline_us;
+    }
+
+    uint getMaxCatchupSteps() const {
+        return max_catchup_steps;
+    }
+
+    unsigned long getPeriodMicros() const {
+        return period_us;
+    }
+
+    // Number of animation steps due at time now_us (0 when the next deadline is not reached yet)
+    uint stepsDue(unsigned long now_us) {
+        long late_us = (long)(now_us - next_deadline_us);
+        if ( late_us < 0 ) {
+            return 0;
+        }
+
+        uint steps = late_us / period_us + 1;
+        if ( steps > max_catchup_steps ) {
+            // Too late to catch up, restart the timeline
+            dropped_frames += steps - 1;
+            next_deadline_us = now_us + period_us;
+            return 1;
+        }
+
+        dropped_frames += steps - 1;
+        next_deadline_us += steps * period_us;
+        return steps;
+    }
+
+    // Time left before the next frame, negative if it is late
+    long slackMicros(unsigned long now_us) const {
+        return (long)(next_deadline_us - now_us);
+    }
+
+    // Frames that were not rendered because the loop was late
+    uint32_t getDroppedFrames() const {
+        return dropped_frames;
+    }
+};
+
+#endif
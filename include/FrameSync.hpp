@@ -0,0 +1,228 @@
+#ifndef FRAMESYNC_HPP
+#define FRAMESYNC_HPP
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include <WiFiUdp.h>
+
+#include "FastRandom.hpp"
+#include "FrameScheduler.hpp"
+
+// Shared timeline between several nodes (e.g. the tree and the outdoor matrix), so that their animations show the
+// same frame numbers at the same time.
+// The leader multicasts its clock (microseconds since boot, 64 bits) and a random seed every interval_ms. The
+// followers estimate the offset between their clock and the leader's. Every node then derives the frame number from
+// the shared time and the frame period, and the random numbers of a frame from the seed and the frame number.
+// A follower that has not heard from the leader for timeout_ms runs on its own clock again.
+//
+// Packet (16 bytes, little endian): "LSY1", seed (32 bits), leader time in us (64 bits)
+enum SyncMode { SYNC_OFF, SYNC_LEADER, SYNC_FOLLOWER };
+
+class FrameSync {
+private:
+    static const uint PACKET_SIZE = 16;
+
+    // A larger difference with the current offset means the leader has restarted
+    static const int64_t OFFSET_JUMP_US = 100000;
+
+    // Frames that the shared clock may go back (small offset corrections) before the timeline is restarted
+    static const int32_t MAX_FRAMES_BACK = 2;
+
+    WiFiUDP udp;
+    SyncMode mode;
+    IPAddress interface_address;
+    IPAddress group;
+    uint16_t port;
+    unsigned long interval_ms;
+    unsigned long timeout_ms;
+    unsigned long last_send_ms;
+
+    uint32_t seed;
+    int64_t offset_us; // Shared time - local time
+    bool synchronized;
+    unsigned long last_packet_ms;
+
+    // Local clock extended to 64 bits
+    uint64_t local_us;
+    unsigned long last_micros;
+
+    uint32_t packets;
+
+    // Last frame computed on the shared timeline
+    uint32_t frame;
+    bool frame_valid;
+
+    static void writeLittleEndian(uint8_t *bytes, uint64_t value, uint size) {
+        for ( uint i = 0; i < size; i++ ) {
+            bytes[i] = value >> (8 * i);
+        }
+    }
+
+    static uint64_t readLittleEndian(const uint8_t *bytes, uint size) {
+        uint64_t value = 0;
+        for ( uint i = 0; i < size; i++ ) {
+            value |= (uint64_t)bytes[i] << (8 * i);
+        }
+        return value;
+    }
+
+    void send(unsigned long now_us) {
+        uint8_t packet[PACKET_SIZE] = { 'L', 'S', 'Y', '1' };
+        writeLittleEndian(packet + 4, seed, 4);
+        writeLittleEndian(packet + 8, toShared(now_us), 8);
+
+        udp.beginPacketMulticast(group, port, interface_address);
+        udp.write(packet, PACKET_SIZE);
+        udp.endPacket();
+    }
+
+    void receive(unsigned long now_us, unsigned long now_ms) {
+        while ( udp.parsePacket() > 0 ) {
+            uint8_t packet[PACKET_SIZE];
+            if ( udp.read(packet, PACKET_SIZE) != (int)PACKET_SIZE || memcmp(packet, "LSY1", 4) != 0 ) {
+                continue;
+            }
+
+            uint32_t packet_seed = readLittleEndian(packet + 4, 4);
+            int64_t sample = (int64_t)readLittleEndian(packet + 8, 8) - (int64_t)extend(now_us);
+
+            // The network delay makes the samples smaller than the real offset: a larger sample is closer to it. The
+            // smaller ones only pull the offset slowly, to follow the drift between the clocks.
+            if ( !synchronized || packet_seed != seed || sample > offset_us || offset_us - sample > OFFSET_JUMP_US ) {
+                // New leader or restarted leader: the shared clock may have gone back, the next frame starts a new
+                // timeline instead of waiting for the previous frame number
+                if ( !synchronized || packet_seed != seed || offset_us - sample > OFFSET_JUMP_US ) {
+                    frame_valid = false;
+                }
+                offset_us = sample;
+            }
+            else {
+                offset_us -= (offset_us - sample) / 16;
+            }
+
+            seed = packet_seed;
+            synchronized = true;
+            last_packet_ms = now_ms;
+            packets++;
+        }
+
+        if ( synchronized && now_ms - last_packet_ms > timeout_ms ) {
+            synchronized = false;
+        }
+    }
+
+public:
+    FrameSync(SyncMode _mode, unsigned long _interval_ms = 1000, unsigned long _timeout_ms = 5000)
+        : mode(_mode), port(0), interval_ms(_interval_ms), timeout_ms(_timeout_ms), last_send_ms(0), seed(0),
+          offset_us(0), synchronized(false), last_packet_ms(0), local_us(0), last_micros(0), packets(0),
+          frame(0), frame_valid(false) {}
+
+    // group_address: multicast group shared by the nodes, e.g. "239.255.76.67"
+    bool begin(IPAddress _interface_address, const char *group_address, uint16_t _port) {
+        if ( mode == SYNC_OFF || !group.fromString(group_address) ) {
+            return false;
+        }
+        interface_address = _interface_address;
+        port = _port;
+        last_micros = micros();
+
+        if ( mode == SYNC_LEADER ) {
+            seed = FastRandom::mix(micros(), port);
+            synchronized = true;
+            return true;
+        }
+        return udp.beginMulticast(interface_address, group, port) == 1;
+    }
+
+    // Must be called at least every hour (the local clock wraps around after 71 minutes)
+    void poll(unsigned long now_us, unsigned long now_ms) {
+        extend(now_us);
+
+        if ( mode == SYNC_LEADER && now_ms - last_send_ms >= interval_ms ) {
+            last_send_ms = now_ms;
+            send(now_us);
+        }
+        else if ( mode == SYNC_FOLLOWER ) {
+            receive(now_us, now_ms);
+        }
+    }
+
+    // Computes the animation steps due (see FrameScheduler::stepsDue()), on the shared timeline when it is known: the
+    // frame number comes from the shared time, and each frame is computed with the random numbers of that frame
+    // (random16() and the seed passed to syncFrame()). The steps missed since the previous frame are computed, but a
+    // node that is too far behind (or ahead, after a new offset) jumps to the current frame.
+    // The scheduler is then aligned on the start of the next shared frame.
+    template<typename Animations>
+    void advance(Animations &animations, FrameScheduler &scheduler, uint steps) {
+        if ( !synchronized ) {
+            frame_valid = false;
+            for ( uint step = 0; step < steps; step++ ) {
+                animations.nextFrame();
+            }
+            return;
+        }
+
+        unsigned long period_us = scheduler.getPeriodMicros();
+        uint32_t current = toShared(micros()) / period_us;
+        int32_t ahead = current - frame;
+
+        if ( ahead < -MAX_FRAMES_BACK ) {
+            // The shared clock went back: continue from its current frame
+            frame_valid = false;
+        }
+
+        if ( !frame_valid || ahead > 0 ) {
+            uint32_t first = frame_valid && ahead <= (int32_t)scheduler.getMaxCatchupSteps() ? frame + 1 : current;
+            for ( uint32_t f = first; f <= current; f++ ) {
+                random16_set_seed(FastRandom::mix(seed, f));
+                animations.syncFrame(f, seed);
+                animations.nextFrame();
+            }
+            frame = current;
+            frame_valid = true;
+        }
+
+        scheduler.setNextDeadline(toLocal((uint64_t)(current + 1) * period_us));
+    }
+
+    // Local micros() value extended to 64 bits
+    uint64_t extend(unsigned long now_us) {
+        local_us += (long)(now_us - last_micros);
+        last_micros = now_us;
+        return local_us;
+    }
+
+    // True when the shared timeline is known (always on the leader)
+    bool isSynchronized() const {
+        return synchronized;
+    }
+
+    // Local micros() value -> shared time
+    uint64_t toShared(unsigned long now_us) const {
+        return local_us + (long)(now_us - last_micros) + offset_us;
+    }
+
+    // Shared time -> local micros() value
+    unsigned long toLocal(uint64_t shared_us) const {
+        return (unsigned long)(shared_us - offset_us - local_us) + last_micros;
+    }
+
+    // Last frame computed by advance() on the shared timeline
+    uint32_t getFrame() const {
+        return frame;
+    }
+
+    uint32_t getSeed() const {
+        return seed;
+    }
+
+    int64_t getOffset() const {
+        return offset_us;
+    }
+
+    uint32_t getPackets() const {
+        return packets;
+    }
+};
+
+#endif
@@ -2,62 +2,122 @@
 #define GREENCHRISTMAS_HPP
 
 #include <FastLED.h>
-#include <vector>
-#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#include "Arena.hpp"
+#include "FastRandom.hpp"
+#include "FrameBuffer.hpp"
+#include "rgbhsv.hpp"
+
+#ifndef FRAMES_PER_SECOND_GREENCHRISTMAS
+#define FRAMES_PER_SECOND_GREENCHRISTMAS 50
+#endif
 
 class GreenChristmas {
 private:
-    std::vector< std::vector<CRGB> > &ledmatrix;
+    FrameBuffer &ledmatrix;
 
-    std::vector< std::vector<uint8_t> > dots;
-
-    static CRGB applyPalette(uint8_t color) {
-        return (CRGB)ColorFromPalette(colorPalette, color);
-    }
+    // Palette index of each LED, row-major
+    uint8_t *dots;
 
     static CHSVPalette16 colorPalette;
 
+    // colorPalette expanded once, ColorFromPalette() is too slow to be called for each LED at 50 fps
+    CRGB paletteColors[256];
+
+    // One random word per LED of a row: bits 0-7 for the twinkle, bits 8-19 to light a candle, bits 20-31 to blow it
+    FastRandom rng;
+    uint32_t *noise;
+
+    uint framerate;
+
 public:
-    GreenChristmas(std::vector< std::vector<CRGB> > &_ledmatrix) : ledmatrix(_ledmatrix) {
+    // Size of the buffers allocated in the arena
+    static constexpr size_t arenaSize(uint rows, uint cols) {
+        return Arena::bytes<uint8_t>(rows * cols) + Arena::bytes<uint32_t>(cols);
+    }
+
+    GreenChristmas(FrameBuffer &_ledmatrix, Arena &arena) : ledmatrix(_ledmatrix), framerate(FRAMES_PER_SECOND_GREENCHRISTMAS) {
         // Initialize the dots with some green color (see the color palette)
-        dots.resize(_ledmatrix.size(), std::vector<uint8_t>(_ledmatrix[0].size(), 63) );
+        dots = arena.allocate<uint8_t>(_ledmatrix.getRows() * _ledmatrix.getCols());
+        memset(dots, 63, _ledmatrix.getRows() * _ledmatrix.getCols());
+        noise = arena.allocate<uint32_t>(_ledmatrix.getCols());
+
+        for ( uint index = 0; index < 256; index++ ) {
+            paletteColors[index] = ColorFromPalette(colorPalette, index);
+        }
     }
 
     void nextFrame()
     {
-        // Compute the new colors
-        for ( auto &row : dots ) {
-            for (uint8_t &color : row) {
-                int change = 0;
+        uint rows = ledmatrix.getRows();
+        uint cols = ledmatrix.getCols();
+        uint8_t *color = dots;
+
+        for ( uint rownum = 0; rownum < rows; rownum++ ) {
+            rng.fill(noise, cols);
+
+            for ( uint colnum = 0; colnum < cols; colnum++, color++ ) {
+                uint32_t random = noise[colnum];
+                uint8_t twinkle = random;
 
-                if( color < 128 ) {
+                if( *color < 128 ) {
                     // Slight twinkle in green areas
-                    change = random8(3) - 1;
+                    *color += ((twinkle * 3) >> 8) - 1;
                 }
                 else {
                     // More twinkle on candles and decorations
-                    change = random8(9) - 4;
+                    *color += ((twinkle * 9) >> 8) - 4;
+                }
+
+                // Light some candles in green areas (~100/65536 per frame)
+                if( ((random >> 8) & 0xFFF) < 6 && *color < 128 ) {
+                    *color = 160;
+                }
+
+                // Blow out some candles (~200/65536 per frame)
+                if( (random >> 20) < 12 && *color > 127 ) {
+                    *color = 31;
                 }
-                color += change;
-                
-                // Light some candles in green areas
-                if( random16() < 100 && color < 128 ) {
-                    color = 160;
-                };
-
-                // Blow out some candles
-                if(random16() < 200 && color > 127) {
-                    color = 31;
-                };
+
+                ledmatrix.at(rownum, colnum) = paletteColors[*color];
             }
         }
+    }
+
+    uint getFramerate() const {
+        return framerate;
+    }
+
+    void setFramerate(uint _framerate) {
+        framerate = _framerate;
+    }
+
+    const char *getName() const {
+        return "christmas";
+    }
+
+    int formatStatus(char *buffer, size_t size) const {
+        return snprintf(buffer, size, "Green Christmas");
+    }
+
+    void setColor(const RgbColor &color) {}
+
+    // Every node uses the same random numbers, but the twinkle is a random walk: nodes that did not start together
+    // keep different colors
+    void syncFrame(uint32_t frame, uint32_t seed) {
+        rng.setSeed(FastRandom::mix(seed, frame));
+    }
+
+    void nextImage() {}
+
+    bool selectImage(const char *name) {
+        return false;
+    }
 
-        // Assign the new colors
-        int rownum = 0;
-        for ( auto row : dots) {
-            std::transform(row.begin(), row.end(), ledmatrix[rownum].begin(), applyPalette);
-            rownum++;
-        }        
+    bool statusChanged() {
+        return false;
     }
 };
 
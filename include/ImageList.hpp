@@ -0,0 +1,142 @@
+#ifndef IMAGELIST_HPP
+#define IMAGELIST_HPP
+
+#include <Arduino.h>
+#include <string.h>
+
+#include <FS.h>
+
+#include "Arena.hpp"
+
+// Arena bytes for the list of files of each image-based animation (and the buffers of the picture being loaded)
+#ifndef IMAGE_ARENA_BUDGET
+#define IMAGE_ARENA_BUDGET 1024
+#endif
+
+// Playlist of the SPIFFS files with the given extensions (e.g. the pictures of ScrollingPicture), in the order of
+// SPIFFS. The names are stored in a part of the arena reserved at startup, which is reset when the list is rebuilt.
+class ImageList {
+private:
+    const char *const *extensions; // nullptr terminated, e.g. { ".bmp", ".lci", nullptr }
+
+    Arena arena;
+    const char **filenames;
+    uint count;
+    uint current;
+
+    bool hasExtension(const char *filename) const {
+        for ( const char *const *extension = extensions; *extension; extension++ ) {
+            if ( strstr(filename, *extension) ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    // Size of the buffers allocated in the arena
+    static constexpr size_t arenaSize() {
+        return Arena::bytes<uint8_t>(IMAGE_ARENA_BUDGET);
+    }
+
+    ImageList(Arena &parent, const char *const *_extensions) : extensions(_extensions), filenames(nullptr), count(0),
+            current(0) {
+        arena = parent.allocateArena(IMAGE_ARENA_BUDGET);
+    }
+
+    // List the files of SPIFFS, the current entry is the first one
+    void list() {
+        arena.reset();
+        filenames = nullptr;
+        count = 0;
+        current = 0;
+
+        if ( !SPIFFS.begin() ) {
+            Serial.print("Could not open SPIFFS.");
+            return;
+        }
+
+        // Count the files first, so that the table of names can be allocated before the names
+        uint n_files = 0;
+        fs::Dir root = SPIFFS.openDir("/");
+        while ( root.next() ) {
+            n_files++;
+        }
+        filenames = arena.allocate<const char *>(n_files);
+        if ( !filenames ) {
+            return;
+        }
+
+        root = SPIFFS.openDir("/");
+        while ( root.next() && count < n_files ) {
+            auto name_string = root.fileName();
+            const char *filename = name_string.c_str();
+
+            if ( hasExtension(filename) ) {
+                char *name = arena.allocate<char>(strlen(filename) + 1);
+                if ( !name ) {
+                    // Too many files for IMAGE_ARENA_BUDGET
+                    break;
+                }
+                strcpy(name, filename);
+                filenames[count++] = name;
+            }
+        }
+    }
+
+    // Index of a file by name, with or without the leading / and the extension, -1 if there is no such file
+    int find(const char *name) const {
+        if ( name[0] == '/' ) {
+            name++;
+        }
+        size_t length = strlen(name);
+
+        for ( uint index = 0; index < count; index++ ) {
+            const char *filename = filenames[index];
+            if ( filename[0] == '/' ) {
+                filename++;
+            }
+            if ( strncmp(filename, name, length) != 0 ) {
+                continue;
+            }
+            if ( filename[length] == '\0' ) {
+                return index;
+            }
+            for ( const char *const *extension = extensions; *extension; extension++ ) {
+                if ( strcmp(filename + length, *extension) == 0 ) {
+                    return index;
+                }
+            }
+        }
+        return -1;
+    }
+
+    // Entry after index, back to the first one after the last one
+    uint next(uint index) const {
+        return index < count - 1 ? index + 1 : 0;
+    }
+
+    // Path of a file, starting with a / (false if it does not fit)
+    bool getPath(uint index, char *path, size_t size) const {
+        const char *filename = filenames[index];
+        return snprintf(path, size, "%s%s", filename[0] == '/' ? "" : "/", filename) < (int)size;
+    }
+
+    uint getCount() const {
+        return count;
+    }
+
+    const char *get(uint index) const {
+        return filenames[index];
+    }
+
+    uint getCurrent() const {
+        return current;
+    }
+
+    void setCurrent(uint index) {
+        current = index;
+    }
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef LEDGEOMETRY_HPP
+#define LEDGEOMETRY_HPP
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#include "LedLayout.hpp"
+
+// Physical position of each LED, in the order of the strip, generated at compile time like the LED maps.
+// Spatial animations compute the color of each LED from its position in a single linear pass over leds[], which also
+// reaches the LEDs that are not part of the matrix (e.g. the horizontal segments of the outdoor lights).
+//
+// The coordinates are fixed point with 8 fractional bits, in matrix cells: the LED at matrix position (row, col) is
+// at (col * LED_CELL, row * LED_CELL).
+struct LedPoint {
+    int16_t x;
+    int16_t y;
+};
+
+static const int16_t LED_CELL = 256;
+
+// Position of the LEDs that are not installed (e.g. the LEDs at the start of the outdoor strip)
+static const int16_t LED_NOT_PLACED = INT16_MIN;
+
+template<uint N_LEDS>
+struct LedGeometry {
+    LedPoint points[N_LEDS];
+
+    constexpr LedGeometry() : points() {
+        for ( uint led = 0; led < N_LEDS; led++ ) {
+            points[led] = LedPoint{ LED_NOT_PLACED, LED_NOT_PLACED };
+        }
+    }
+
+    // Places the LEDs of a matrix wired as layout, at the position of their cell
+    template<uint ROWS, uint COLS>
+    constexpr void placeMatrix(const LedLayout &layout) {
+        for ( uint row = 0; row < ROWS; row++ ) {
+            for ( uint col = 0; col < COLS; col++ ) {
+                uint led = layout.index(row, col, ROWS, COLS);
+                if ( led < N_LEDS ) {
+                    points[led] = LedPoint{ (int16_t)(col * LED_CELL), (int16_t)(row * LED_CELL) };
+                }
+            }
+        }
+    }
+
+    // Places count consecutive LEDs starting at first, evenly spaced on the segment from -> to (ends excluded)
+    constexpr void placeLine(uint first, uint count, LedPoint from, LedPoint to) {
+        for ( uint i = 0; i < count && first + i < N_LEDS; i++ ) {
+            int step = i + 1;
+            points[first + i] = LedPoint{
+                (int16_t)(from.x + (to.x - from.x) * step / (int)(count + 1)),
+                (int16_t)(from.y + (to.y - from.y) * step / (int)(count + 1))
+            };
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef LEDLAYOUT_HPP
+#define LEDLAYOUT_HPP
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// Compile-time generator of the LED maps (matrix position -> LED index, and LED index -> matrix position).
+//
+// The LEDs of a matrix line (a column for vertical strips, a row for horizontal strips) are made of runs of
+// consecutive LEDs:
+//   index(line, pos) = first + line * line_pitch + (pos / run_length) * run_pitch + pos % run_length
+// With serpentine wiring, the odd lines are reversed. LEDs that are skipped between the lines (or between the runs)
+// are simply not part of the map.
+//
+// Example, 15 vertical strips of 25 LEDs starting at LED 33, connected by 3 LEDs that are not in the matrix:
+//   LedLayout::columns(33, 28).serpentine()
+struct LedLayout {
+    uint16_t first;
+    uint16_t line_pitch;
+    uint16_t run_length; // 0: the whole line is a single run
+    uint16_t run_pitch;
+    bool reversed_odd_lines;
+    bool vertical;
+
+    // Lines are matrix columns, column c starts at LED first + c * column_pitch
+    static constexpr LedLayout columns(uint16_t first, uint16_t column_pitch) {
+        return LedLayout{ first, column_pitch, 0, 0, false, true };
+    }
+
+    // Lines are matrix rows, row r starts at LED first + r * row_pitch
+    static constexpr LedLayout rows(uint16_t first, uint16_t row_pitch) {
+        return LedLayout{ first, row_pitch, 0, 0, false, false };
+    }
+
+    // The odd lines are wired in the opposite direction
+    constexpr LedLayout serpentine() const {
+        return LedLayout{ first, line_pitch, run_length, run_pitch, true, vertical };
+    }
+
+    // Each line is made of runs of length consecutive LEDs, the runs start every pitch LEDs
+    constexpr LedLayout runs(uint16_t length, uint16_t pitch) const {
+        return LedLayout{ first, line_pitch, length, pitch, reversed_odd_lines, vertical };
+    }
+
+    constexpr uint16_t index(uint row, uint col, uint rows, uint cols) const {
+        uint line = vertical ? col : row;
+        uint pos = vertical ? row : col;
+        uint line_length = vertical ? rows : cols;
+
+        if ( reversed_odd_lines && (line % 2) == 1 ) {
+            pos = line_length - 1 - pos;
+        }
+
+        uint run = run_length ? run_length : line_length;
+        return first + line * line_pitch + (pos / run) * run_pitch + pos % run;
+    }
+};
+
+// Matrix position -> LED index, row-major. Usually stored in flash (PROGMEM), read it with pgm_read_word().
+template<uint ROWS, uint COLS>
+struct LedMap {
+    uint16_t index[ROWS * COLS];
+};
+
+// LED index -> matrix position ((row << 8) | col), LED_NOT_MAPPED for the LEDs that are not in the matrix
+static const uint16_t LED_NOT_MAPPED = 0xFFFF;
+
+template<uint N_LEDS>
+struct LedInverseMap {
+    uint16_t position[N_LEDS];
+};
+
+template<uint ROWS, uint COLS>
+constexpr LedMap<ROWS, COLS> makeLedMap(const LedLayout &layout) {
+    LedMap<ROWS, COLS> map = {};
+    for ( uint row = 0; row < ROWS; row++ ) {
+        for ( uint col = 0; col < COLS; col++ ) {
+            map.index[row * COLS + col] = layout.index(row, col, ROWS, COLS);
+        }
+    }
+    return map;
+}
+
+template<uint N_LEDS, uint ROWS, uint COLS>
+constexpr LedInverseMap<N_LEDS> makeLedInverseMap(const LedLayout &layout) {
+    static_assert(ROWS < 256 && COLS < 256, "The matrix positions are stored on 8 bits");
+
+    LedInverseMap<N_LEDS> inverse = {};
+    for ( uint led = 0; led < N_LEDS; led++ ) {
+        inverse.position[led] = LED_NOT_MAPPED;
+    }
+    for ( uint row = 0; row < ROWS; row++ ) {
+        for ( uint col = 0; col < COLS; col++ ) {
+            uint16_t led = layout.index(row, col, ROWS, COLS);
+            if ( led < N_LEDS ) {
+                inverse.position[led] = (row << 8) | col;
+            }
+        }
+    }
+    return inverse;
+}
+
+#endif
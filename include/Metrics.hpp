@@ -0,0 +1,87 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Operational counters and gauges, published as a JSON snapshot (see formatJson).
+// The values are kept in fixed arrays indexed by the caller's enums, so the updates on the hot path are plain integer
+// operations: nothing is formatted or allocated until a snapshot is requested.
+//
+// Counters only increase (the reader computes the rates from two snapshots), gauges are set to the last value or
+// keep the highest value since the previous snapshot (setMax, then resetPeaks() after the snapshot).
+template<uint N_COUNTERS, uint N_GAUGES>
+class Metrics {
+private:
+    const char *const *counter_names;
+    const char *const *gauge_names;
+
+    uint32_t counters[N_COUNTERS];
+    int32_t gauges[N_GAUGES];
+
+    // Gauges updated with setMax(), reset by resetPeaks()
+    bool peaks[N_GAUGES];
+
+public:
+    Metrics(const char *const *_counter_names, const char *const *_gauge_names) : counter_names(_counter_names),
+            gauge_names(_gauge_names) {
+        memset(counters, 0, sizeof(counters));
+        memset(gauges, 0, sizeof(gauges));
+        memset(peaks, 0, sizeof(peaks));
+    }
+
+    void add(uint counter, uint32_t n = 1) {
+        counters[counter] += n;
+    }
+
+    void set(uint gauge, int32_t value) {
+        gauges[gauge] = value;
+    }
+
+    // Highest value since the previous snapshot
+    void setMax(uint gauge, int32_t value) {
+        peaks[gauge] = true;
+        if ( value > gauges[gauge] ) {
+            gauges[gauge] = value;
+        }
+    }
+
+    uint32_t getCounter(uint counter) const {
+        return counters[counter];
+    }
+
+    int32_t getGauge(uint gauge) const {
+        return gauges[gauge];
+    }
+
+    // Start the peak gauges again, after a snapshot
+    void resetPeaks() {
+        for ( uint gauge = 0; gauge < N_GAUGES; gauge++ ) {
+            if ( peaks[gauge] ) {
+                gauges[gauge] = 0;
+            }
+        }
+    }
+
+    // Compact JSON: {"<counter>":N,...,"<gauge>":N,...}, returns the length of the text
+    int formatJson(char *buffer, size_t size) const {
+        int len = snprintf(buffer, size, "{");
+
+        for ( uint counter = 0; counter < N_COUNTERS && len < (int)size; counter++ ) {
+            len += snprintf(buffer + len, size - len, "%s\"%s\":%u", counter > 0 ? "," : "", counter_names[counter],
+                            (unsigned)counters[counter]);
+        }
+
+        for ( uint gauge = 0; gauge < N_GAUGES && len < (int)size; gauge++ ) {
+            len += snprintf(buffer + len, size - len, ",\"%s\":%d", gauge_names[gauge], (int)gauges[gauge]);
+        }
+
+        if ( len < (int)size ) {
+            len += snprintf(buffer + len, size - len, "}");
+        }
+        return len;
+    }
+};
+
+#endif
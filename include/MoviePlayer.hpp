@@ -0,0 +1,207 @@
+#ifndef MOVIEPLAYER_HPP
+#define MOVIEPLAYER_HPP
+
+#include <FastLED.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include <FS.h>
+
+#include "Arena.hpp"
+#include "FrameBuffer.hpp"
+#include "FrameRecorder.hpp"
+#include "ImageList.hpp"
+#include "rgbhsv.hpp"
+
+// Should be at least the frame rate of the movies
+#ifndef FRAMES_PER_SECOND_MOVIEPLAYER
+#define FRAMES_PER_SECOND_MOVIEPLAYER 50
+#endif
+
+static const char *const MOVIE_EXTENSIONS[] = { ".lfr", nullptr };
+
+// Plays frame animations (fireworks, snowfall...) stored in SPIFFS as .lfr files: delta-compressed frames in matrix
+// order, with the duration of each frame (timed stream, see FrameRecorder.hpp and tools/anim2lfr.py).
+// The file is streamed through a small read buffer and each frame is decoded into a copy of the matrix kept in the
+// arena (the delta frames are applied to the previous one, while the LEDs are also drawn by the other animations).
+// The memory usage does not depend on the length of the movie.
+// Each frame is shown for its duration, independently of the frame rate of the animation. Frames of untimed streams
+// are shown for one animation frame. The movie loops, nextImage() and selectImage() go through the .lfr files like the
+// pictures of ScrollingPicture.
+class MoviePlayer {
+private:
+    // Sequential reads through a buffer: a frame is made of many small reads
+    class BufferedFile {
+    private:
+        static const uint READ_BUFFER_SIZE = 128;
+
+        fs::File file;
+        uint8_t read_buffer[READ_BUFFER_SIZE];
+        uint read_buffer_pos;
+        uint read_buffer_len;
+
+    public:
+        BufferedFile() : read_buffer_pos(0), read_buffer_len(0) {}
+
+        void open(fs::File _file) {
+            file = _file;
+            read_buffer_pos = 0;
+            read_buffer_len = 0;
+        }
+
+        void close() {
+            file.close();
+        }
+
+        bool rewind() {
+            read_buffer_pos = 0;
+            read_buffer_len = 0;
+            return file && file.seek(0, SeekSet);
+        }
+
+        size_t read(uint8_t *data, size_t size) {
+            size_t done = 0;
+            while ( done < size ) {
+                if ( read_buffer_pos >= read_buffer_len ) {
+                    read_buffer_len = file ? file.read(read_buffer, READ_BUFFER_SIZE) : 0;
+                    read_buffer_pos = 0;
+                    if ( read_buffer_len == 0 ) {
+                        break;
+                    }
+                }
+                size_t length = std::min<size_t>(size - done, read_buffer_len - read_buffer_pos);
+                memcpy(data + done, read_buffer + read_buffer_pos, length);
+                read_buffer_pos += length;
+                done += length;
+            }
+            return done;
+        }
+    };
+
+    // Frames decoded in one step at most, when the frames are shorter than the animation frames
+    static const uint MAX_FRAMES_PER_STEP = 8;
+
+    FrameBuffer &ledmatrix;
+    ImageList movies;
+
+    CRGB *pixels; // Current frame of the movie, row-major
+    FrameReplayer replayer;
+    BufferedFile file;
+    bool playing;
+    int current_movie; // Index in the list of movies, -1 if none is playing
+
+    int32_t remaining_us; // Time left before the next frame of the movie, decoded when it is reached
+    uint framerate;
+
+    // Back to the first frame, returns false if the file is not a frame stream of the matrix size
+    bool restart() {
+        playing = file.rewind() && replayer.begin(file) && replayer.getCount() == ledmatrix.getRows() * ledmatrix.getCols()
+            && replayer.getCols() == ledmatrix.getCols();
+        remaining_us = 0;
+        return playing;
+    }
+
+    void openMovie(uint index) {
+        file.close();
+        current_movie = index;
+        movies.setCurrent(index);
+
+        char path[40];
+        if ( movies.getPath(index, path, sizeof(path)) && SPIFFS.begin() && SPIFFS.exists(path) ) {
+            file.open(SPIFFS.open(path, "r"));
+        }
+        if ( !restart() ) {
+            Serial.printf("%s is not a movie of %ux%u LEDs\n", path, ledmatrix.getRows(), ledmatrix.getCols());
+            memset((void *)pixels, 0, ledmatrix.getRows() * ledmatrix.getCols() * sizeof(CRGB));
+        }
+    }
+
+    // Decode the next frame, from the start at the end of the movie
+    bool nextMovieFrame() {
+        if ( replayer.next(file) ) {
+            return true;
+        }
+        return restart() && replayer.next(file);
+    }
+
+public:
+    // Size of the buffers allocated in the arena
+    static constexpr size_t arenaSize(uint rows, uint cols) {
+        return ImageList::arenaSize() + Arena::bytes<CRGB>(rows * cols);
+    }
+
+    MoviePlayer(FrameBuffer &_ledmatrix, Arena &arena) : ledmatrix(_ledmatrix), movies(arena, MOVIE_EXTENSIONS),
+            pixels(arena.allocate<CRGB>(_ledmatrix.getRows() * _ledmatrix.getCols())),
+            replayer(pixels, _ledmatrix.getRows() * _ledmatrix.getCols()), playing(false), current_movie(-1),
+            remaining_us(0), framerate(FRAMES_PER_SECOND_MOVIEPLAYER) {
+        movies.list();
+    }
+
+    void nextFrame() {
+        for ( uint decoded = 0; playing && remaining_us <= 0; decoded++ ) {
+            if ( decoded == MAX_FRAMES_PER_STEP || !nextMovieFrame() ) {
+                // Late (or the file cannot be read): continue from here
+                remaining_us = 0;
+                break;
+            }
+            remaining_us += replayer.isTimed() ? replayer.getDuration() * 1000 : 1000000 / framerate;
+        }
+
+        uint cols = ledmatrix.getCols();
+        for ( uint row = 0; row < ledmatrix.getRows(); row++ ) {
+            for ( uint col = 0; col < cols; col++ ) {
+                ledmatrix.at(row, col) = pixels[row * cols + col];
+            }
+        }
+        remaining_us -= 1000000 / framerate;
+    }
+
+    // Next movie of the list
+    void nextImage() {
+        if ( movies.getCount() > 0 ) {
+            openMovie(movies.next(movies.getCurrent()));
+        }
+    }
+
+    // Movie by file name, with or without the leading / and the extension. Returns false if there is no such movie.
+    bool selectImage(const char *name) {
+        int index = movies.find(name);
+        if ( index < 0 ) {
+            return false;
+        }
+        openMovie(index);
+        return true;
+    }
+
+    const char *getCurrentMovie() const {
+        return current_movie >= 0 ? movies.get(current_movie) : "";
+    }
+
+    // The movies are not aligned on the shared frame number
+    void syncFrame(uint32_t frame, uint32_t seed) {}
+
+    uint getFramerate() const {
+        return framerate;
+    }
+
+    void setFramerate(uint _framerate) {
+        framerate = _framerate;
+    }
+
+    const char *getName() const {
+        return "movie";
+    }
+
+    int formatStatus(char *buffer, size_t size) const {
+        return snprintf(buffer, size, "Movie: %s", getCurrentMovie());
+    }
+
+    void setColor(const RgbColor &color) {}
+
+    bool statusChanged() {
+        return false;
+    }
+};
+
+#endif
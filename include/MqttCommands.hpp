@@ -0,0 +1,157 @@
+#ifndef MQTTCOMMANDS_HPP
+#define MQTTCOMMANDS_HPP
+
+#include <Arduino.h>
+#include <string.h>
+
+// Commands received on MQTT, parsed in place from the message without any allocation. The callback of the MQTT
+// client only parses the message and queues the command, the frame loop executes it.
+enum CommandType : uint8_t {
+    COMMAND_COLOR,      // value: 0xRRGGBB
+    COMMAND_POWER,      // value: 1 = on, 0 = off
+    COMMAND_BRIGHTNESS, // value: 0-255
+    COMMAND_FPS,        // value: frames per second of the current animation
+    COMMAND_ANIMATION,  // name: animation name or index, empty for the next animation
+    COMMAND_IMAGE,      // name: image file name, empty for the next image
+    COMMAND_SHADER,     // the shader is too long for name: the MQTT callback copies the payload
+};
+
+struct Command {
+    static const uint NAME_SIZE = 32;
+
+    CommandType type;
+    uint32_t value;
+    char name[NAME_SIZE];
+};
+
+struct MqttTopic {
+    const char *topic;
+    CommandType type;
+};
+
+class MqttCommandParser {
+private:
+    const MqttTopic *topics;
+    uint n_topics;
+
+    // Length of the prefix shared by all the topics (the root topic), it is compared once per message and then only
+    // the suffixes are compared
+    size_t prefix_length;
+
+    // Decimal number, false if the payload is empty, not a number or larger than max
+    static bool parseUint(const uint8_t *payload, uint length, uint32_t max, uint32_t &value) {
+        if ( length == 0 ) {
+            return false;
+        }
+        value = 0;
+        for ( uint i = 0; i < length; i++ ) {
+            if ( payload[i] < '0' || payload[i] > '9' ) {
+                return false;
+            }
+            value = value * 10 + (payload[i] - '0');
+            if ( value > max ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // "#RRGGBB" or "RRGGBB"
+    static bool parseColor(const uint8_t *payload, uint length, uint32_t &color) {
+        if ( length == 7 && payload[0] == '#' ) {
+            payload++;
+            length--;
+        }
+        if ( length != 6 ) {
+            return false;
+        }
+
+        color = 0;
+        for ( uint i = 0; i < length; i++ ) {
+            uint8_t c = payload[i];
+            uint8_t digit;
+            if ( c >= '0' && c <= '9' ) {
+                digit = c - '0';
+            }
+            else if ( (c | 0x20) >= 'a' && (c | 0x20) <= 'f' ) {
+                digit = (c | 0x20) - 'a' + 10;
+            }
+            else {
+                return false;
+            }
+            color = (color << 4) | digit;
+        }
+        return true;
+    }
+
+    static bool payloadEquals(const uint8_t *payload, uint length, const char *text) {
+        return strlen(text) == length && memcmp(payload, text, length) == 0;
+    }
+
+public:
+    MqttCommandParser(const MqttTopic *_topics, uint _n_topics) : topics(_topics), n_topics(_n_topics) {
+        prefix_length = n_topics > 0 ? strlen(topics[0].topic) : 0;
+        for ( uint i = 1; i < n_topics; i++ ) {
+            size_t length = 0;
+            while ( length < prefix_length && topics[i].topic[length] == topics[0].topic[length] ) {
+                length++;
+            }
+            prefix_length = length;
+        }
+    }
+
+    // Returns false if the topic is unknown or the payload is invalid
+    bool parse(const char *topic, const uint8_t *payload, uint length, Command &command) const {
+        if ( strncmp(topic, topics[0].topic, prefix_length) != 0 ) {
+            return false;
+        }
+        const char *suffix = topic + prefix_length;
+
+        const MqttTopic *match = nullptr;
+        for ( uint i = 0; i < n_topics && !match; i++ ) {
+            if ( strcmp(suffix, topics[i].topic + prefix_length) == 0 ) {
+                match = &topics[i];
+            }
+        }
+        if ( !match ) {
+            return false;
+        }
+
+        command.type = match->type;
+        command.value = 0;
+        command.name[0] = '\0';
+
+        switch ( command.type ) {
+            case COMMAND_COLOR:
+                return parseColor(payload, length, command.value);
+
+            case COMMAND_POWER:
+                if ( payloadEquals(payload, length, "ON") ) {
+                    command.value = 1;
+                    return true;
+                }
+                return payloadEquals(payload, length, "OFF");
+
+            case COMMAND_BRIGHTNESS:
+                return parseUint(payload, length, 255, command.value);
+
+            case COMMAND_FPS:
+                return parseUint(payload, length, 1000, command.value) && command.value > 0;
+
+            case COMMAND_SHADER:
+                return length > 0;
+
+            case COMMAND_ANIMATION:
+            case COMMAND_IMAGE:
+                if ( length >= Command::NAME_SIZE ) {
+                    return false;
+                }
+                memcpy(command.name, payload, length);
+                command.name[length] = '\0';
+                return true;
+        }
+        return false;
+    }
+};
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef PLASMAWAVES_HPP
+#define PLASMAWAVES_HPP
+
+#include <FastLED.h>
+#include <stdio.h>
+
+#include "Arena.hpp"
+#include "FrameBuffer.hpp"
+#include "LedGeometry.hpp"
+#include "rgbhsv.hpp"
+
+#ifndef FRAMES_PER_SECOND_PLASMAWAVES
+#define FRAMES_PER_SECOND_PLASMAWAVES 30
+#endif
+
+// Spatial animation: 3 moving sine waves (horizontal, vertical and diagonal) summed at the position of each LED, in
+// shades around the selected color.
+// It is computed over the LED positions of the frame buffer, in the order of the strip, so every installed LED is lit
+// (including the ones outside of the matrix). Without positions, the same function is sampled at the matrix cells.
+class PlasmaWaves {
+private:
+    FrameBuffer &ledmatrix;
+    CRGB *palette; // Wave value -> color, rebuilt when the color changes
+    uint8_t hue;
+    RgbColor color;
+    uint32_t time; // Frames
+    uint framerate;
+
+    void buildPalette() {
+        for ( uint value = 0; value < 256; value++ ) {
+            // Darker and shifted towards the next hue in the troughs
+            hsv2rgb_rainbow(CHSV(hue + 24 - (value >> 3), 255, dim8_raw(value)), palette[value]);
+        }
+    }
+
+    // Wave value at position (x, y), wavelengths of 4 cells horizontally and 8 cells vertically and diagonally
+    uint8_t valueAt(int16_t x, int16_t y, uint8_t phase_x, uint8_t phase_y, uint8_t phase_xy) const {
+        uint8_t a = sin8((uint8_t)(x >> 2) + phase_x);
+        uint8_t b = sin8((uint8_t)(y >> 3) + phase_y);
+        uint8_t c = sin8((uint8_t)((x + y) >> 3) - phase_xy);
+        return (a + b + 2 * c) >> 2;
+    }
+
+public:
+    // Size of the buffers allocated in the arena
+    static constexpr size_t arenaSize(uint rows, uint cols) {
+        return Arena::bytes<CRGB>(256);
+    }
+
+    PlasmaWaves(FrameBuffer &_ledmatrix, Arena &arena) : ledmatrix(_ledmatrix), hue(160), color{ 0, 0, 0 }, time(0),
+            framerate(FRAMES_PER_SECOND_PLASMAWAVES) {
+        palette = arena.allocate<CRGB>(256);
+        buildPalette();
+    }
+
+    void nextFrame() {
+        time++;
+        uint8_t phase_x = time * 3;
+        uint8_t phase_y = time * 2;
+        uint8_t phase_xy = time * 5;
+
+        if ( ledmatrix.hasGeometry() ) {
+            const LedPoint *points = ledmatrix.getPoints();
+            CRGB *leds = ledmatrix.getLeds();
+            uint count = ledmatrix.getLedCount();
+
+            for ( uint led = 0; led < count; led++ ) {
+                LedPoint point = points[led];
+                if ( point.x != LED_NOT_PLACED ) {
+                    leds[led] = palette[ valueAt(point.x, point.y, phase_x, phase_y, phase_xy) ];
+                }
+            }
+        }
+        else {
+            for ( uint row = 0; row < ledmatrix.getRows(); row++ ) {
+                for ( uint col = 0; col < ledmatrix.getCols(); col++ ) {
+                    ledmatrix.at(row, col) = palette[ valueAt(col * LED_CELL, row * LED_CELL, phase_x, phase_y, phase_xy) ];
+                }
+            }
+        }
+    }
+
+    void setColor(const RgbColor &_color) {
+        color = _color;
+        hue = RgbToHsv(_color).h;
+        buildPalette();
+    }
+
+    // The waves only depend on the frame number
+    void syncFrame(uint32_t frame, uint32_t seed) {
+        time = frame - 1;
+    }
+
+    uint getFramerate() const {
+        return framerate;
+    }
+
+    void setFramerate(uint _framerate) {
+        framerate = _framerate;
+    }
+
+    const char *getName() const {
+        return "plasma";
+    }
+
+    int formatStatus(char *buffer, size_t size) const {
+        return snprintf(buffer, size, "Plasma: RGB=%u,%u,%u", color.r, color.g, color.b);
+    }
+
+    void nextImage() {}
+
+    bool selectImage(const char *name) {
+        return false;
+    }
+
+    bool statusChanged() {
+        return false;
+    }
+};
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef POWERLIMITER_HPP
+#define POWERLIMITER_HPP
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include <algorithm>
+
+#include "FrameChangeDetector.hpp"
+
+// Keeps the current drawn by the LEDs within the budget of the power supply, and of each segment of the strip (the
+// LEDs fed by the same power injection point), by lowering the global brightness.
+// The current is estimated in the pass over the LEDs that computes the frame hash for FrameChangeDetector, so it does
+// not cost a second pass over leds[] (as FastLED's setMaxPowerInMilliWatts() would).
+// The brightness limit drops at once when a frame exceeds the budget, and rises back slowly, only when the budget
+// allows at least hysteresis levels more: a few bright frames (e.g. sparkles) do not make the brightness oscillate.
+//
+// Current model (as FastLED's power functions): 16 mA red, 11 mA green, 15 mA blue at full brightness, 1 mA per LED
+// when dark.
+template<uint N_SEGMENTS>
+class PowerLimiter {
+private:
+    static const uint32_t RED_MA = 16;
+    static const uint32_t GREEN_MA = 11;
+    static const uint32_t BLUE_MA = 15;
+    static const uint32_t DARK_MA = 1;
+
+    uint segment_leds;
+    uint32_t segment_max_ma;
+    uint32_t total_max_ma;
+    uint8_t hysteresis;
+    uint8_t ramp_up;
+
+    // Current of each segment at full brightness, in 1/255 mA, without the dark current
+    uint32_t segment_current[N_SEGMENTS];
+    uint segment_count[N_SEGMENTS];
+
+    uint8_t limit;
+    uint8_t brightness;
+    uint32_t limited_frames;
+
+    // Highest brightness for which the dynamic current stays below the budget
+    static uint8_t maxBrightness(uint32_t dynamic_current, uint32_t budget_ma, uint32_t dark_ma) {
+        if ( budget_ma <= dark_ma ) {
+            return 0;
+        }
+        // dynamic_current is in 1/255 mA at brightness 255: the current at brightness b is dynamic_current * b / 65025
+        uint64_t max = (uint64_t)(budget_ma - dark_ma) * 65025 / (dynamic_current ? dynamic_current : 1);
+        return max > 255 ? 255 : max;
+    }
+
+public:
+    // segment_leds: LEDs per segment, the last segment can be shorter
+    PowerLimiter(uint _segment_leds, uint32_t _segment_max_ma, uint32_t _total_max_ma, uint8_t _hysteresis = 8, uint8_t _ramp_up = 2)
+        : segment_leds(_segment_leds), segment_max_ma(_segment_max_ma), total_max_ma(_total_max_ma), hysteresis(_hysteresis),
+          ramp_up(_ramp_up), segment_current(), segment_count(), limit(255), brightness(255), limited_frames(0) {}
+
+    // Estimates the current of each segment and returns the hash of the frame (FrameChangeDetector::hash()), in a
+    // single pass over the LEDs
+    uint32_t scan(const CRGB *leds, uint count) {
+        uint32_t h = FrameChangeDetector::HASH_SEED;
+        uint first = 0;
+
+        for ( uint segment = 0; segment < N_SEGMENTS; segment++ ) {
+            uint last = segment == N_SEGMENTS - 1 ? count : std::min(count, first + segment_leds);
+            uint32_t red = 0;
+            uint32_t green = 0;
+            uint32_t blue = 0;
+
+            for ( uint i = first; i < last; i++ ) {
+                const CRGB &led = leds[i];
+                h = FrameChangeDetector::hashStep(h, led);
+                red += led.r;
+                green += led.g;
+                blue += led.b;
+            }
+
+            segment_current[segment] = red * RED_MA + green * GREEN_MA + blue * BLUE_MA;
+            segment_count[segment] = last > first ? last - first : 0;
+            first = last;
+        }
+        return h;
+    }
+
+    // Brightness to use for the frame scanned last, given the requested brightness
+    uint8_t apply(uint8_t requested) {
+        uint32_t total_current = 0;
+        uint total_leds = 0;
+        uint8_t target = requested;
+
+        for ( uint segment = 0; segment < N_SEGMENTS; segment++ ) {
+            total_current += segment_current[segment];
+            total_leds += segment_count[segment];
+            target = std::min(target, maxBrightness(segment_current[segment], segment_max_ma, segment_count[segment] * DARK_MA));
+        }
+        target = std::min(target, maxBrightness(total_current, total_max_ma, total_leds * DARK_MA));
+
+        if ( target < limit ) {
+            // Over budget: limit at once
+            limit = target;
+        }
+        else if ( target >= limit + hysteresis || target == requested ) {
+            // Enough margin: rise back smoothly
+            limit = std::min<uint>(target, limit + ramp_up);
+        }
+
+        brightness = std::min(requested, limit);
+        if ( brightness < requested ) {
+            limited_frames++;
+        }
+        return brightness;
+    }
+
+    // Estimated current of a segment at the brightness returned by apply(), in mA
+    uint32_t getSegmentCurrent(uint segment) const {
+        return (uint64_t)segment_current[segment] * brightness / 65025 + segment_count[segment] * DARK_MA;
+    }
+
+    uint32_t getTotalCurrent() const {
+        uint32_t total = 0;
+        for ( uint segment = 0; segment < N_SEGMENTS; segment++ ) {
+            total += getSegmentCurrent(segment);
+        }
+        return total;
+    }
+
+    uint8_t getLimit() const {
+        return limit;
+    }
+
+    // Frames shown with less than the requested brightness
+    uint32_t getLimitedFrames() const {
+        return limited_frames;
+    }
+};
+
+#endif
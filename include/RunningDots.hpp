@@ -2,73 +2,146 @@
 #define RUNNINGDOTS_HPP
 
 #include <FastLED.h>
-#include <vector>
+#include <stdio.h>
 #include <algorithm>
 
+#include "Arena.hpp"
+#include "FrameBuffer.hpp"
+#include "ColorRamp.hpp"
+#include "rgbhsv.hpp"
+
+#ifndef FRAMES_PER_SECOND_RUNNINGDOTS
+#define FRAMES_PER_SECOND_RUNNINGDOTS 24
+#endif
+
 class RunningDots {
 private:
-    std::vector< std::vector<CRGB> > &ledmatrix;
-    std::vector<uint8_t> intensities;
-    std::vector<int> positions;
+    FrameBuffer &ledmatrix;
+    uint8_t *intensities;
+    CRGB *ramp; // Tail, dot and head colors, rebuilt when the hue changes
+    int rampLength;
+    int *positions;
     int maxPosition;
     int minPosition;
     int tailLength;
     int headLength;
     int hue;
+    RgbColor color;
+    uint framerate;
 
 public:
-    RunningDots(std::vector< std::vector<CRGB> > &_ledmatrix, int _tailLength, int _headLength) : ledmatrix(_ledmatrix), positions(_ledmatrix.size(), -_headLength-1) {
+    // Size of the buffers allocated in the arena
+    static constexpr size_t arenaSize(uint rows, uint cols, int tailLength = 5, int headLength = 2) {
+        return Arena::bytes<uint8_t>(tailLength + headLength + 1) + Arena::bytes<CRGB>(tailLength + headLength + 1)
+            + Arena::bytes<int>(rows);
+    }
+
+    RunningDots(FrameBuffer &_ledmatrix, Arena &arena, int _tailLength = 5, int _headLength = 2) : ledmatrix(_ledmatrix) {
         tailLength = _tailLength;
         headLength = _headLength;
-        maxPosition = _ledmatrix[0].size() + _tailLength;
+        maxPosition = _ledmatrix.getCols() + _tailLength;
         minPosition = -_headLength;
 
         hue = 204;
+        color = { 0, 0, 0 };
+        framerate = FRAMES_PER_SECOND_RUNNINGDOTS;
+
+        rampLength = _tailLength + _headLength + 1;
+        intensities = arena.allocate<uint8_t>(rampLength);
+        ramp = arena.allocate<CRGB>(rampLength);
+        positions = arena.allocate<int>(_ledmatrix.getRows());
+        std::fill(positions, positions + _ledmatrix.getRows(), -_headLength-1);
 
         // Tail and main dot intensities
         for ( int i = 0; i < _tailLength + 1; i++ ) {
             uint8_t intensity = triwave8( i * 80 / _tailLength + 47 );
-            intensities.push_back( dim8_raw(intensity) );
+            intensities[i] = dim8_raw(intensity);
         }
         // Head intensities
         for ( int i = 1; i < _headLength + 1; i++ ) {
             uint8_t intensity = triwave8( 127 + i * 80 / _headLength );
-            intensities.push_back( dim8_raw(intensity) );
+            intensities[_tailLength + i] = dim8_raw(intensity);
         }
+
+        buildRamp();
+    }
+
+    void buildRamp() {
+        hsvValuesToRgb(hue, 255, intensities, ramp, rampLength);
     }
 
     void nextFrame() {
-        for ( auto &position : positions ) {
+        for ( int *position = positions; position < positions + ledmatrix.getRows(); position++ ) {
             // Set new position for lines that are already running
-            if ( position >= minPosition ) {
-                position = (position < maxPosition) ? position+1 : minPosition-1;
+            if ( *position >= minPosition ) {
+                *position = (*position < maxPosition) ? *position+1 : minPosition-1;
             }
 
             // Start some lines randomly
-            if ( position < minPosition && random16() < 400 ) {
-                position = minPosition;
+            if ( *position < minPosition && random16() < 400 ) {
+                *position = minPosition;
             }
         }
         
-        // Set the LEDs intensities
-        for ( uint rownum = 0; rownum < ledmatrix.size(); rownum++ ){
+        // Set the LEDs colors: black, then the visible part of the color ramp, then black
+        int cols = ledmatrix.getCols();
+        for ( uint rownum = 0; rownum < ledmatrix.getRows(); rownum++ ){
             if ( positions[rownum] >= 0 ) {
-                for ( uint colnum = 0; colnum < ledmatrix[rownum].size(); colnum++ ){
-                    uint intensitiesIndex = colnum - positions[rownum] + tailLength;
-                    
-                    if ( intensitiesIndex >= 0 && intensitiesIndex < intensities.size() ) {
-                        ledmatrix[rownum][colnum] = CHSV(hue, 255, intensities[intensitiesIndex] );
-                    }
-                    else {
-                        ledmatrix[rownum][colnum] = CRGB::Black;
-                    }
+                int ramp_start = positions[rownum] - tailLength;
+                int begin = std::max(0, ramp_start);
+                int end = std::min(cols, ramp_start + rampLength);
+
+                if ( begin < end ) {
+                    ledmatrix.fillRow(rownum, 0, begin, CRGB::Black);
+                    ledmatrix.copyToRow(rownum, begin, &ramp[begin - ramp_start], end - begin);
+                    ledmatrix.fillRow(rownum, end, cols - end, CRGB::Black);
+                }
+                else {
+                    ledmatrix.fillRow(rownum, CRGB::Black);
                 }
             }
         }
     }
 
     void setHue(uint8_t _hue) {
-        hue = _hue;
+        if ( _hue != hue ) {
+            hue = _hue;
+            buildRamp();
+        }
+    }
+
+    void setColor(const RgbColor &_color) {
+        color = _color;
+        setHue( RgbToHsv(_color).h );
+    }
+
+    uint getFramerate() const {
+        return framerate;
+    }
+
+    void setFramerate(uint _framerate) {
+        framerate = _framerate;
+    }
+
+    const char *getName() const {
+        return "dots";
+    }
+
+    int formatStatus(char *buffer, size_t size) const {
+        return snprintf(buffer, size, "Points: RGB=%u,%u,%u", color.r, color.g, color.b);
+    }
+
+    // The lines are started with random16(), seeded by the caller
+    void syncFrame(uint32_t frame, uint32_t seed) {}
+
+    void nextImage() {}
+
+    bool selectImage(const char *name) {
+        return false;
+    }
+
+    bool statusChanged() {
+        return false;
     }
 };
 
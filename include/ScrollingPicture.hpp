@@ -2,180 +2,494 @@
 #define SCROLLINGPICTURE_HPP
 
 #include <FastLED.h>
-#include <vector>
+#include <stdio.h>
+#include <string.h>
 #include <algorithm>
 
 #include <FS.h>
 
+#include "Arena.hpp"
+#include "FrameBuffer.hpp"
+#include "ColumnImage.hpp"
+#include "ImageList.hpp"
+#include "rgbhsv.hpp"
+
+#ifndef FRAMES_PER_SECOND_SCROLLINGPICTURE
+#define FRAMES_PER_SECOND_SCROLLINGPICTURE 50
+#endif
+
+// Scroll speed, independent of the frame rate
+#ifndef SCROLLINGPICTURE_COLUMNS_PER_SECOND
+#define SCROLLINGPICTURE_COLUMNS_PER_SECOND 10
+#endif
+
+// Picture bytes read per frame while the next picture is loaded in the background
+#ifndef IMAGE_LOAD_BYTES_PER_FRAME
+#define IMAGE_LOAD_BYTES_PER_FRAME 1024
+#endif
+
+static const char *const PICTURE_EXTENSIONS[] = { ".bmp", ".lci", nullptr };
+
+// Scrolls a picture from right to left over the LED matrix.
+// Pictures are either 24 bit BMP files saved by the GIMP, or precompiled .lci files (see ColumnImage.hpp), which are
+// smaller and much faster to read.
+// The picture is streamed from SPIFFS: only a window of columns (matrix width + some lookahead columns) is kept in a
+// ring buffer, the next columns are read from the file as the picture scrolls. The memory usage does not depend on
+// the width of the picture.
+// The scroll position has 16 fractional bits: between two columns, each LED blends the 2 picture columns around it
+// (8 bit weight), so the picture scrolls smoothly at any frame rate.
+//
+// Pictures are double-buffered: a new picture is opened and its first columns are read into the back picture, at most
+// IMAGE_LOAD_BYTES_PER_FRAME bytes per frame, while the current one keeps scrolling. The pictures are swapped when the
+// load is complete (statusChanged() then returns true). After a swap, the next picture of the list is preloaded, so
+// that nextImage() usually shows it at once.
 class ScrollingPicture {
 private:
-    std::vector< std::vector<CRGB> > &ledmatrix;
+    // A picture and the window of its columns that are in memory
+    struct Picture {
+        // Ring buffer of picture columns, column-major: picture column c is stored in slot (c % window_cols)
+        CRGB *window;
 
-    std::vector< std::vector<CRGB> > picture;
+        // Range of picture columns currently held in the window [window_begin, window_end)
+        int window_begin;
+        int window_end;
 
-    std::vector< std::string > bmp_filenames;
-    std::vector< std::string >::iterator current_bmp_filename_it;
+        fs::File file;
+        ColumnImage column_image;
+        bool is_column_image;
+        uint32_t bmp_data_location;
+        uint32_t bmp_row_size;
+        uint width;
+        uint height;
 
-    int max_scroll_position;
-    int min_scroll_position;
-    int scroll_position;
+        int filename; // Index in the list of pictures, -1 for the solid color shown when there is no picture
+    };
+
+    // Back picture: nothing to load, file to open, columns to read, ready to be shown
+    enum LoadState { LOAD_IDLE, LOAD_OPEN, LOAD_COLUMNS, LOAD_READY };
+
+    FrameBuffer &ledmatrix;
+
+    uint window_cols;
+    uint lookahead_cols;
+
+    // Current and back picture, the animation is moved into the registry so they are selected by index
+    Picture pictures[2];
+    uint current_picture;
+    bool has_picture;
+
+    LoadState load_state;
+    bool show_when_ready; // Swap as soon as the back picture is ready, else it is only preloaded
+    bool status_changed;
+
+    // Available pictures (.bmp and .lci files)
+    ImageList images;
+
+    // Matrix column of the left edge of the picture, 16 fractional bits
+    int32_t max_scroll_position;
+    int32_t min_scroll_position;
+    int32_t scroll_position;
+    int32_t scroll_step; // Per frame
+
+    uint framerate;
+    uint columns_per_second;
+
+    static const int32_t ONE_COLUMN = 1 << 16;
+
+    void updateStep() {
+        scroll_step = ((int64_t)columns_per_second * ONE_COLUMN + framerate / 2) / framerate;
+    }
+
+    // Copy the picture column into a matrix column, or blend it with the next one (weight: 0-255 for the next one).
+    // Columns outside of the picture are nullptr (black).
+    void drawColumn(uint colnum, const CRGB *column, const CRGB *next_column, uint8_t weight) {
+        uint rows = ledmatrix.getRows();
+
+        if ( weight == 0 || (column == nullptr && next_column == nullptr) ) {
+            for ( uint rownum = 0; rownum < rows; rownum++ ) {
+                ledmatrix.at(rownum, colnum) = column ? column[rownum] : CRGB(CRGB::Black);
+            }
+            return;
+        }
+
+        uint keep = 256 - weight;
+        for ( uint rownum = 0; rownum < rows; rownum++ ) {
+            CRGB a = column ? column[rownum] : CRGB(CRGB::Black);
+            CRGB b = next_column ? next_column[rownum] : CRGB(CRGB::Black);
+            ledmatrix.at(rownum, colnum) = CRGB( (a.r * keep + b.r * weight) >> 8, (a.g * keep + b.g * weight) >> 8,
+                (a.b * keep + b.b * weight) >> 8 );
+        }
+    }
 
     uint32_t readInt(fs::File &file, uint start_position, uint length) {
         if (length > 4) {
             length = 4;
         }
 
-        char readbuf[5];
+        uint8_t readbuf[4];
         file.seek(start_position, SeekSet);
-        file.readBytes(readbuf, length);
+        file.read(readbuf, length);
 
-        // Convert char* to int, little-endian
+        // Convert bytes to int, little-endian
         uint32_t readInt = 0;
         for (uint i = 0; i < length; i++) {
-            readInt |= readbuf[i] << (8 * i);
+            readInt |= (uint32_t)readbuf[i] << (8 * i);
         }
 
         return readInt;
     }
 
-public:
-    ScrollingPicture(std::vector< std::vector<CRGB> > &_ledmatrix) : ledmatrix(_ledmatrix) {
-        // Initial scroll position is 1 step outside the matrix on the right
-        max_scroll_position = _ledmatrix[0].size();
-        scroll_position = max_scroll_position;
+    Picture &current() {
+        return pictures[current_picture];
+    }
 
-        // This value will be updated when loading a picture
-        min_scroll_position = 0;
+    const Picture &current() const {
+        return pictures[current_picture];
+    }
 
-        // List available bmp files
-        if ( SPIFFS.begin() ) {
-            fs::Dir root = SPIFFS.openDir("/");
+    Picture &back() {
+        return pictures[1 - current_picture];
+    }
 
-            while ( root.next() ) {
-                std::string filename = std::string( root.fileName().c_str() );
+    CRGB *windowColumn(Picture &picture, int col) {
+        return &picture.window[ (col % window_cols) * ledmatrix.getRows() ];
+    }
 
-                if ( filename.find(".bmp") != std::string::npos ) {
-                    bmp_filenames.push_back( filename );
-                }
+    void loadColumn(Picture &picture, int col) {
+        CRGB *column = windowColumn(picture, col);
+        uint rows = ledmatrix.getRows();
+
+        if ( picture.is_column_image ) {
+            // The columns are decoded sequentially, restart from the beginning when the picture wraps around
+            if ( (uint)col < picture.column_image.getNextColumn() ) {
+                picture.column_image.rewind();
             }
-            current_bmp_filename_it = bmp_filenames.begin();
+            while ( picture.column_image.getNextColumn() < (uint)col ) {
+                picture.column_image.skipColumn();
+            }
+            picture.column_image.readColumn(column, rows);
+            return;
         }
-        else {
-            Serial.print("Could not open SPIFFS.");
+
+        for (uint row = 0; row < rows; row++) {
+            if ( picture.file && row < picture.height ) {
+                uint pixel_offset = picture.bmp_data_location + row * picture.bmp_row_size + col * 3; // 24 bit color = 3 Bytes
+                column[row] = readInt(picture.file, pixel_offset, 3);
+            }
+            else {
+                column[row] = CRGB::Black;
+            }
         }
-        
     }
 
-    void loadImage(std::string picture_filename) {
-        bool image_loaded = false;
+    // Make sure the window holds the columns [begin, end) of the picture
+    void fetchColumns(Picture &picture, int begin, int end) {
+        end = std::min(end, (int)picture.width);
+
+        // The picture wrapped around: start filling the window again from the requested column
+        if ( begin < picture.window_begin ) {
+            picture.window_begin = begin;
+            picture.window_end = begin;
+        }
 
-        if ( SPIFFS.begin() ) {
-            // Make sure the filename starts with a /
-            size_t slash_pos = picture_filename.find("/");
-            if ( slash_pos == std::string::npos || slash_pos != 0 ) {
-                picture_filename = "/" + picture_filename;
+        while ( picture.window_end < end ) {
+            // Drop the oldest column when the window is full
+            if ( picture.window_end - picture.window_begin == (int)window_cols ) {
+                picture.window_begin++;
             }
+            loadColumn(picture, picture.window_end);
+            picture.window_end++;
+        }
+    }
 
-            if ( SPIFFS.exists(picture_filename.c_str()) ) {
-                fs::File bmp_image = SPIFFS.open(picture_filename.c_str(), "r");
+    // Open a picture file (index in the list of pictures, -1 for a solid color), no column is read yet
+    void openPicture(Picture &picture, int filename) {
+        bool image_loaded = false;
+
+        picture.file.close();
+        picture.column_image.close();
+        picture.is_column_image = false;
+        picture.filename = filename;
+
+        char path[40];
+        if ( filename >= 0 && images.getPath(filename, path, sizeof(path)) && SPIFFS.begin() ) {
+            if ( strstr(path, ".lci") && SPIFFS.exists(path) ) {
+                if ( picture.column_image.begin( SPIFFS.open(path, "r") ) ) {
+                    picture.width = picture.column_image.getWidth();
+                    picture.height = picture.column_image.getHeight();
+                    picture.is_column_image = true;
+                    image_loaded = true;
+                }
+            }
+            else if ( SPIFFS.exists(path) ) {
+                picture.file = SPIFFS.open(path, "r");
 
                 // These locations correspond to the bmp image saved by the GIMP, different headers exist
                 // GIMP save configuration: "Do not write colorspace information", "24 bit R8 G8 B8"
                 // Location of the BMP data is located in bytes 10:13
-                uint32_t bmp_data_location = readInt(bmp_image, 10, 4);
-                
+                picture.bmp_data_location = readInt(picture.file, 10, 4);
+
                 // Width of the BMP image is located in bytes 18:21
-                uint32_t bmp_width = readInt(bmp_image, 18, 4);
+                picture.width = readInt(picture.file, 18, 4);
 
                 // Height of the BMP image is located in bytes 22:25
-                uint32_t bmp_height = readInt(bmp_image, 22, 4);
+                picture.height = readInt(picture.file, 22, 4);
 
-                picture.clear();
-                for (uint row = 0; row < bmp_height; row++) {
-                    std::vector<CRGB> line;
+                // The row size must be a multiple of 4 bytes (padding bytes are added at the end)
+                picture.bmp_row_size = ( (picture.width * 24 + 31) / 32 ) * 4;
 
-                    // The row size must be a multiple of 4 bytes (padding bytes are added at the end)
-                    uint row_offset = row * ( (bmp_width * 24 + 31) / 32 ) * 4;
-
-                    for (uint col = 0; col < bmp_width; col++) {
-                        uint pixel_offset = bmp_data_location + row_offset + col * 3; // 24 bit color = 3 Bytes
-                        line.push_back( readInt(bmp_image, pixel_offset, 3) );
-                    }
-
-                    picture.push_back(line);
-                }
-                scroll_position = max_scroll_position;
-                min_scroll_position = -bmp_width;
                 image_loaded = true;
             }
         }
 
         // If the bmp could not be loaded, initialize the picture with some solid color
         if ( !image_loaded ) {
-            picture.resize(ledmatrix.size(), std::vector<CRGB>(ledmatrix[0].size(), 0x404040) );
-        }
-    }
-
-    void loadNextBMP() {
-        if ( current_bmp_filename_it != bmp_filenames.end()-1 ) {
-            current_bmp_filename_it++;
+            picture.file.close();
+            picture.column_image.close();
+            picture.filename = -1;
+            picture.width = ledmatrix.getCols();
+            picture.height = ledmatrix.getRows();
+            std::fill(picture.window, picture.window + window_cols * ledmatrix.getRows(), CRGB(0x404040));
+            picture.window_begin = 0;
+            picture.window_end = picture.width;
         }
         else {
-            current_bmp_filename_it = bmp_filenames.begin();
+            picture.window_begin = 0;
+            picture.window_end = 0;
         }
-        
-        loadImage(*current_bmp_filename_it);
     }
 
-    std::string getCurrentBmpFilename() {
-        return *current_bmp_filename_it;
+    // Show the current picture from the start (on the right of the matrix)
+    void restartScroll() {
+        scroll_position = max_scroll_position;
+        min_scroll_position = -(int32_t)current().width * ONE_COLUMN;
     }
 
-    void nextFrame() {
-        
-        scroll_position = scroll_position > min_scroll_position ? scroll_position-1 : max_scroll_position;
+    // Start loading a picture into the back picture
+    void startLoad(int filename, bool show) {
+        back().file.close();
+        back().column_image.close();
+        back().filename = filename;
+        load_state = LOAD_OPEN;
+        show_when_ready = show;
+    }
 
-        // Start with all LEDs black
-        for ( auto &row : ledmatrix ) {
-            for ( auto &led : row ) {
-                led = CRGB::Black;
+    // Next step of the background load: open the file, then read the first columns of the window
+    void loadStep() {
+        if ( load_state == LOAD_OPEN ) {
+            openPicture(back(), back().filename);
+            load_state = LOAD_COLUMNS;
+        }
+        else if ( load_state == LOAD_COLUMNS ) {
+            uint rows = ledmatrix.getRows();
+            int columns = std::max<int>(1, IMAGE_LOAD_BYTES_PER_FRAME / (rows * 3));
+            int end = std::min<int>(std::min<int>(window_cols, back().width), back().window_end + columns);
+            fetchColumns(back(), 0, end);
+
+            if ( back().window_end >= std::min<int>(window_cols, back().width) ) {
+                load_state = LOAD_READY;
             }
         }
 
-        // Set the LEDs colors by copying the picture into the correct position
-        for ( uint rownum = 0; rownum < ledmatrix.size(); rownum++ ){
-            std::vector<CRGB> picture_line = picture[rownum];
+        if ( load_state == LOAD_READY && show_when_ready ) {
+            swapPictures();
+        }
+    }
 
-            auto picture_begin_it = picture_line.begin();
-            auto picture_end_it = picture_line.end();
-            auto led_begin_it = ledmatrix[rownum].begin();
+    void swapPictures() {
+        current_picture = 1 - current_picture;
+        restartScroll();
+        images.setCurrent(std::max(0, current().filename));
+        status_changed = true;
+        load_state = LOAD_IDLE;
 
-            // Left part of the picture is cropped if the scroll position is outside (left) of the LED matrix
-            if ( scroll_position < 0 ) {
-                picture_begin_it = picture_line.begin() - scroll_position;
-            }
+        // Preload the next picture
+        if ( images.getCount() > 1 ) {
+            startLoad(images.next(images.getCurrent()), false);
+        }
+    }
 
-            // Right part of the picture is cropped so that it does not go outside (right) of the LED matrix
-            if ( (picture_end_it - picture_line.begin() + scroll_position) > ledmatrix[rownum].size() ) {
-                picture_end_it = picture_line.begin() + ledmatrix[rownum].size() - scroll_position;
+    // Show a picture: at once for the first one, else after it has been loaded in the background
+    void showPicture(int filename) {
+        if ( !has_picture ) {
+            openPicture(current(), filename);
+            images.setCurrent(std::max(0, current().filename));
+            restartScroll();
+            has_picture = true;
+            if ( images.getCount() > 1 ) {
+                startLoad(images.next(images.getCurrent()), false);
             }
+            return;
+        }
 
-            // Set the start column on the LED matrix for when the scroll has not reached the leftmost column
-            if ( scroll_position > 0 ) {
-                led_begin_it = led_begin_it + scroll_position;
+        if ( load_state != LOAD_IDLE && back().filename == filename ) {
+            // Already loading or preloaded
+            show_when_ready = true;
+            if ( load_state == LOAD_READY ) {
+                swapPictures();
             }
+            return;
+        }
+        startLoad(filename, true);
+    }
 
-            // Copy the picture to the LED matrix at the correct position
-            std::copy(picture_begin_it, picture_end_it, led_begin_it);
+public:
+    ScrollingPicture(FrameBuffer &_ledmatrix, Arena &arena, uint _lookahead_cols = 4) : ledmatrix(_ledmatrix),
+            images(arena, PICTURE_EXTENSIONS) {
+        // Initial scroll position is 1 step outside the matrix on the right
+        max_scroll_position = _ledmatrix.getCols() * ONE_COLUMN;
+        scroll_position = max_scroll_position;
 
-            // Add some sparkling
-            for ( CRGB &led : ledmatrix[rownum] ) {
-                if ( random16() < 2000 ) {
-                    led = CRGB::White;
-                }
-            }
+        // This value will be updated when loading a picture
+        min_scroll_position = 0;
+
+        framerate = FRAMES_PER_SECOND_SCROLLINGPICTURE;
+        columns_per_second = SCROLLINGPICTURE_COLUMNS_PER_SECOND;
+        updateStep();
+
+        // One more column than the matrix width: the blended columns
+        lookahead_cols = _lookahead_cols;
+        window_cols = _ledmatrix.getCols() + 1 + _lookahead_cols;
+        for ( Picture &picture : pictures ) {
+            picture.window = arena.allocate<CRGB>(window_cols * _ledmatrix.getRows());
+            picture.window_begin = 0;
+            picture.window_end = 0;
+            picture.is_column_image = false;
+            picture.width = 0;
+            picture.height = 0;
+            picture.filename = -1;
+        }
+        current_picture = 0;
+        has_picture = false;
+        load_state = LOAD_IDLE;
+        show_when_ready = false;
+        status_changed = false;
+
+        listImages();
+    }
+
+    // Size of the buffers allocated in the arena
+    static constexpr size_t arenaSize(uint rows, uint cols, uint lookahead_cols = 4) {
+        return ImageList::arenaSize() + 2 * Arena::bytes<CRGB>((cols + 1 + lookahead_cols) * rows);
+    }
+
+    // List the available pictures
+    void listImages() {
+        images.list();
+    }
+
+    // Next picture of the list, shown when it has been loaded
+    void loadNextBMP() {
+        if ( images.getCount() == 0 ) {
+            showPicture(-1);
+            return;
+        }
+
+        // Next to the picture being loaded, if a picture was requested already
+        uint filename = load_state != LOAD_IDLE && show_when_ready ? back().filename : images.getCurrent();
+        showPicture(images.next(filename));
+    }
+
+    // Load a picture by file name, with or without the leading / and the extension, it is shown when it has been loaded.
+    // Returns false if there is no such picture.
+    bool selectImage(const char *name) {
+        int index = images.find(name);
+        if ( index < 0 ) {
+            return false;
+        }
+        showPicture(index);
+        return true;
+    }
+
+    const char *getCurrentBmpFilename() const {
+        if ( current().filename < 0 ) {
+            return "";
+        }
+        return images.get(current().filename);
+    }
+
+    uint getFramerate() const {
+        return framerate;
+    }
+
+    void setFramerate(uint _framerate) {
+        framerate = _framerate;
+        updateStep();
+    }
+
+    uint getColumnsPerSecond() const {
+        return columns_per_second;
+    }
+
+    void setColumnsPerSecond(uint _columns_per_second) {
+        columns_per_second = _columns_per_second;
+        updateStep();
+    }
+
+    const char *getName() const {
+        return "picture";
+    }
+
+    int formatStatus(char *buffer, size_t size) const {
+        return snprintf(buffer, size, "Image: %s", getCurrentBmpFilename());
+    }
+
+    void setColor(const RgbColor &color) {}
+
+    void nextImage() {
+        loadNextBMP();
+    }
+
+    // True once after a picture requested with nextImage() or selectImage() is shown
+    bool statusChanged() {
+        bool changed = status_changed;
+        status_changed = false;
+        return changed;
+    }
+
+    // True while a picture is being loaded in the background
+    bool isLoading() const {
+        return load_state == LOAD_OPEN || load_state == LOAD_COLUMNS;
+    }
+
+    // The scroll position is derived from the frame number: nextFrame() then shows the same columns on every node
+    void syncFrame(uint32_t frame, uint32_t seed) {
+        // Same as frame steps from max_scroll_position, wrapped into [min_scroll_position, max_scroll_position + 1)
+        int64_t length = (int64_t)max_scroll_position - min_scroll_position + ONE_COLUMN;
+        int64_t target = max_scroll_position - (int64_t)((uint64_t)frame * scroll_step % length);
+        if ( target < min_scroll_position ) {
+            target += length;
+        }
+        scroll_position = target + scroll_step;
+    }
+
+    void nextFrame() {
+        loadStep();
+
+        scroll_position -= scroll_step;
+        if ( scroll_position < min_scroll_position ) {
+            scroll_position += max_scroll_position - min_scroll_position + ONE_COLUMN;
+        }
+
+        // Picture column shown by matrix column c: c - scroll_position, between columns first + c and first + c + 1
+        int32_t offset = -scroll_position;
+        int first = offset >> 16;
+        uint8_t weight = offset >> 8;
+
+        // Picture columns that are visible on the LED matrix, and the ones that will be needed soon
+        int cols = ledmatrix.getCols();
+        int visible_begin = std::max(0, first);
+        int visible_end = std::min((int)current().width, first + cols + (weight ? 1 : 0));
+        fetchColumns(current(), visible_begin, visible_end + lookahead_cols);
+
+        // Single pass per column: read the picture columns, blend and write the LEDs, black outside of the picture
+        for ( int colnum = 0; colnum < cols; colnum++ ) {
+            int picture_col = first + colnum;
+            const CRGB *column = picture_col >= visible_begin && picture_col < visible_end ? windowColumn(current(), picture_col) : nullptr;
+            const CRGB *next_column = picture_col + 1 >= visible_begin && picture_col + 1 < visible_end ? windowColumn(current(), picture_col + 1) : nullptr;
+            drawColumn(colnum, column, next_column, weight);
         }
     }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,158 @@
+#ifndef SHADERANIMATION_HPP
+#define SHADERANIMATION_HPP
+
+#include <FastLED.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Arena.hpp"
+#include "FrameBuffer.hpp"
+#include "LedGeometry.hpp"
+#include "ShaderCompiler.hpp"
+#include "ShaderVM.hpp"
+#include "rgbhsv.hpp"
+
+#ifndef FRAMES_PER_SECOND_SHADER
+#define FRAMES_PER_SECOND_SHADER 24
+#endif
+
+// Instructions run per frame at most (program length * LEDs), programs that need more are rejected.
+// See the pixels/s of the native benchmark: the frame must be computed well within 1 / FRAMES_PER_SECOND_SHADER.
+#ifndef SHADER_MAX_INSTRUCTIONS_PER_FRAME
+#define SHADER_MAX_INSTRUCTIONS_PER_FRAME 16000
+#endif
+
+// Shown until a shader is loaded: rainbow with moving diagonal waves
+#ifndef SHADER_DEFAULT_SOURCE
+#define SHADER_DEFAULT_SOURCE "h = x / 16 + t / 4; v = tri(x / 8 + y / 8 - t / 2)"
+#endif
+
+// Runs a pixel shader (see ShaderCompiler.hpp) for every LED: new effects can be sent on MQTT, as source code or as
+// bytecode compiled on the host, without a new firmware.
+// Like PlasmaWaves, the shader is run at the position of every installed LED if the frame buffer has the positions,
+// else at the matrix cells.
+class ShaderAnimation {
+private:
+    FrameBuffer &ledmatrix;
+    ShaderProgram *program;
+    ShaderVM vm;
+    uint8_t hue; // Of the selected color
+    uint32_t time; // Frames
+    uint framerate;
+    char status[48];
+
+    uint ledCount() const {
+        return ledmatrix.hasGeometry() ? ledmatrix.getLedCount() : ledmatrix.getRows() * ledmatrix.getCols();
+    }
+
+    // Programs that do not fit in the instruction budget are rejected, the current one is kept
+    bool load(const ShaderProgram &candidate) {
+        if ( candidate.length * ledCount() > SHADER_MAX_INSTRUCTIONS_PER_FRAME ) {
+            snprintf(status, sizeof(status), "too slow (%u instructions)", candidate.length);
+            return false;
+        }
+        *program = candidate;
+        snprintf(status, sizeof(status), "%u instructions", program->length);
+        return true;
+    }
+
+public:
+    // Size of the buffers allocated in the arena
+    static constexpr size_t arenaSize(uint rows, uint cols) {
+        return Arena::bytes<ShaderProgram>(1);
+    }
+
+    ShaderAnimation(FrameBuffer &_ledmatrix, Arena &arena) : ledmatrix(_ledmatrix), hue(0), time(0),
+            framerate(FRAMES_PER_SECOND_SHADER) {
+        program = arena.allocate<ShaderProgram>(1);
+        status[0] = '\0';
+        loadShader(SHADER_DEFAULT_SOURCE, strlen(SHADER_DEFAULT_SOURCE));
+    }
+
+    // Source code, or bytecode in hexadecimal. Returns false (and the current shader is kept) if it is not valid or
+    // too slow, the error is in the status.
+    bool loadShader(const char *text, size_t length) {
+        ShaderProgram candidate;
+        if ( candidate.fromHex(text, length) ) {
+            return load(candidate);
+        }
+
+        char source[256];
+        if ( length >= sizeof(source) ) {
+            snprintf(status, sizeof(status), "source too long");
+            return false;
+        }
+        memcpy(source, text, length);
+        source[length] = '\0';
+
+        ShaderCompiler compiler(candidate);
+        if ( !compiler.compile(source) ) {
+            snprintf(status, sizeof(status), "%s at %u", compiler.getError(), compiler.getErrorPosition());
+            return false;
+        }
+        return load(candidate);
+    }
+
+    void nextFrame() {
+        time++;
+        vm.beginFrame(((int64_t)time << 8) / framerate, hue);
+
+        if ( ledmatrix.hasGeometry() ) {
+            const LedPoint *points = ledmatrix.getPoints();
+            CRGB *leds = ledmatrix.getLeds();
+            uint count = ledmatrix.getLedCount();
+
+            for ( uint led = 0; led < count; led++ ) {
+                LedPoint point = points[led];
+                if ( point.x != LED_NOT_PLACED ) {
+                    leds[led] = vm.shade(*program, point.x, point.y, led);
+                }
+            }
+        }
+        else {
+            uint cols = ledmatrix.getCols();
+            for ( uint row = 0; row < ledmatrix.getRows(); row++ ) {
+                for ( uint col = 0; col < cols; col++ ) {
+                    ledmatrix.at(row, col) = vm.shade(*program, col * LED_CELL, row * LED_CELL, row * cols + col);
+                }
+            }
+        }
+    }
+
+    // The shaders only depend on the time
+    void syncFrame(uint32_t frame, uint32_t seed) {
+        time = frame - 1;
+    }
+
+    void setColor(const RgbColor &color) {
+        hue = RgbToHsv(color).h;
+    }
+
+    uint getFramerate() const {
+        return framerate;
+    }
+
+    void setFramerate(uint _framerate) {
+        framerate = _framerate;
+    }
+
+    const char *getName() const {
+        return "shader";
+    }
+
+    int formatStatus(char *buffer, size_t size) const {
+        return snprintf(buffer, size, "Shader: %s", status);
+    }
+
+    void nextImage() {}
+
+    bool selectImage(const char *name) {
+        return false;
+    }
+
+    bool statusChanged() {
+        return false;
+    }
+};
+
+#endif
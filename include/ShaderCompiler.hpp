@@ -0,0 +1,447 @@
+#ifndef SHADERCOMPILER_HPP
+#define SHADERCOMPILER_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include "ShaderVM.hpp"
+
+// Compiles the shader language to the bytecode of ShaderVM, without any allocation (on the device for the shaders
+// received on MQTT, or on the host with native/shader).
+// A shader is a list of assignments, separated by new lines or ';', '#' starts a comment:
+//   h = x / 16 + t / 4
+//   v = tri(x / 8 + y / 8 - t)
+// Expressions: numbers (1, 0.25), the inputs and outputs (see ShaderVM.hpp), variables, + - * / % (modulo),
+// parentheses and the functions sin(a), cos(a), tri(a), abs(a), frac(a), min(a, b), max(a, b), lt(a, b) (1 if a < b)
+// and if(c, a, b) (a if c is not 0, else b). Assigning r, g or b selects the RGB mode, h, s or v the HSV mode.
+class ShaderCompiler {
+private:
+    static const uint MAX_VARIABLES = 8;
+
+    struct Name {
+        const char *text;
+        uint length;
+    };
+
+    const char *source;
+    const char *p;
+    ShaderProgram &program;
+    const char *error;
+    bool hsv_outputs;
+    bool rgb_outputs;
+
+    // Variables are allocated from the last register down, temporaries from SHADER_FIRST_TEMP up
+    Name variables[MAX_VARIABLES];
+    uint n_variables;
+    uint n_temps;
+
+    bool fail(const char *message) {
+        if ( !error ) {
+            error = message;
+        }
+        return false;
+    }
+
+    void skipSpaces() {
+        while ( *p == ' ' || *p == '\t' || *p == '\r' ) {
+            p++;
+        }
+        if ( *p == '#' ) {
+            while ( *p && *p != '\n' ) {
+                p++;
+            }
+        }
+    }
+
+    bool accept(char c) {
+        skipSpaces();
+        if ( *p == c ) {
+            p++;
+            return true;
+        }
+        return false;
+    }
+
+    bool expect(char c, const char *message) {
+        return accept(c) || fail(message);
+    }
+
+    static bool isLetter(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    }
+
+    static bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    Name parseName() {
+        skipSpaces();
+        Name name = { p, 0 };
+        while ( isLetter(*p) || (name.length > 0 && isDigit(*p)) ) {
+            p++;
+            name.length++;
+        }
+        return name;
+    }
+
+    static bool nameIs(const Name &name, const char *text) {
+        return strlen(text) == name.length && strncmp(name.text, text, name.length) == 0;
+    }
+
+    uint8_t variableRegister(uint index) const {
+        return SHADER_REGISTERS - 1 - index;
+    }
+
+    bool isTemp(uint8_t reg) const {
+        return reg >= SHADER_FIRST_TEMP && reg < SHADER_FIRST_TEMP + n_temps;
+    }
+
+    uint8_t newTemp() {
+        if ( SHADER_FIRST_TEMP + n_temps >= SHADER_REGISTERS - n_variables ) {
+            fail("expression too complex");
+            return SHADER_FIRST_TEMP;
+        }
+        return SHADER_FIRST_TEMP + n_temps++;
+    }
+
+    // Temporaries are released in the reverse order of their allocation
+    void release(uint8_t reg) {
+        if ( isTemp(reg) && reg == SHADER_FIRST_TEMP + n_temps - 1 ) {
+            n_temps--;
+        }
+    }
+
+    void emit(uint8_t op, uint8_t d, uint8_t a, uint8_t b) {
+        if ( program.length == SHADER_MAX_INSTRUCTIONS ) {
+            fail("program too long");
+            return;
+        }
+        program.code[program.length++] = ShaderInstruction{ op, d, a, b };
+    }
+
+    uint8_t unary(uint8_t op, uint8_t a) {
+        uint8_t d = isTemp(a) ? a : newTemp();
+        emit(op, d, a, 0);
+        return d;
+    }
+
+    // a was computed before b: if both are temporaries, b is the last one
+    uint8_t binary(uint8_t op, uint8_t a, uint8_t b) {
+        uint8_t d = isTemp(a) ? a : (isTemp(b) ? b : newTemp());
+        emit(op, d, a, b);
+        if ( b != d ) {
+            release(b);
+        }
+        return d;
+    }
+
+    // Register of an input, output or variable, -1 if there is none with this name
+    int nameRegister(const Name &name) {
+        static const char *const registers[] = { "x", "y", "t", "i", "hue" };
+        for ( uint reg = 0; reg < sizeof(registers) / sizeof(registers[0]); reg++ ) {
+            if ( nameIs(name, registers[reg]) ) {
+                return reg;
+            }
+        }
+
+        int output = outputRegister(name);
+        if ( output >= 0 ) {
+            return output;
+        }
+
+        for ( uint index = 0; index < n_variables; index++ ) {
+            if ( name.length == variables[index].length && strncmp(name.text, variables[index].text, name.length) == 0 ) {
+                return variableRegister(index);
+            }
+        }
+        return -1;
+    }
+
+    int outputRegister(const Name &name) {
+        static const char *const hsv[] = { "h", "s", "v" };
+        static const char *const rgb[] = { "r", "g", "b" };
+        for ( uint i = 0; i < 3; i++ ) {
+            if ( nameIs(name, hsv[i]) ) {
+                hsv_outputs = true;
+                return SHADER_OUT0 + i;
+            }
+            if ( nameIs(name, rgb[i]) ) {
+                rgb_outputs = true;
+                return SHADER_OUT0 + i;
+            }
+        }
+        return -1;
+    }
+
+    // Constants are 16 bits: -128 to 127.996
+    uint8_t parseNumber(bool negative) {
+        int32_t value = 0;
+        while ( isDigit(*p) ) {
+            value = value * 10 + (*p++ - '0');
+            if ( value > 128 ) {
+                value = 128;
+                fail("number out of range (-128 to 127.99)");
+            }
+        }
+        value *= 256;
+
+        if ( *p == '.' ) {
+            p++;
+            int32_t fraction = 0;
+            int32_t scale = 1;
+            while ( isDigit(*p) ) {
+                if ( scale < 100000 ) {
+                    fraction = fraction * 10 + (*p - '0');
+                    scale *= 10;
+                }
+                p++;
+            }
+            value += (fraction * 256 + scale / 2) / scale;
+        }
+
+        // Checked after the rounding of the fraction: 127.999 would be 128
+        if ( value > (negative ? 32768 : 32767) ) {
+            fail("number out of range (-128 to 127.99)");
+        }
+        if ( negative ) {
+            value = -value;
+        }
+
+        uint8_t d = newTemp();
+        emit(SHADER_LDI, d, value & 0xFF, (value >> 8) & 0xFF);
+        return d;
+    }
+
+    uint8_t parseCall(const Name &name) {
+        static const struct { const char *name; uint8_t op; } unary_functions[] = {
+            { "sin", SHADER_SIN }, { "cos", SHADER_COS }, { "tri", SHADER_TRI }, { "abs", SHADER_ABS },
+            { "frac", SHADER_FRAC }
+        };
+        static const struct { const char *name; uint8_t op; } binary_functions[] = {
+            { "min", SHADER_MIN }, { "max", SHADER_MAX }, { "lt", SHADER_LT }
+        };
+
+        for ( const auto &function : unary_functions ) {
+            if ( nameIs(name, function.name) ) {
+                uint8_t a = parseExpression();
+                expect(')', "')' expected");
+                return unary(function.op, a);
+            }
+        }
+
+        for ( const auto &function : binary_functions ) {
+            if ( nameIs(name, function.name) ) {
+                uint8_t a = parseExpression();
+                expect(',', "',' expected");
+                uint8_t b = parseExpression();
+                expect(')', "')' expected");
+                return binary(function.op, a, b);
+            }
+        }
+
+        if ( nameIs(name, "if") ) {
+            // The condition register is overwritten by the result
+            uint8_t c = parseExpression();
+            if ( !isTemp(c) ) {
+                uint8_t temp = newTemp();
+                emit(SHADER_MOV, temp, c, 0);
+                c = temp;
+            }
+            expect(',', "',' expected");
+            uint8_t a = parseExpression();
+            expect(',', "',' expected");
+            uint8_t b = parseExpression();
+            expect(')', "')' expected");
+            emit(SHADER_SEL, c, a, b);
+            release(b);
+            release(a);
+            return c;
+        }
+
+        fail("unknown function");
+        return SHADER_FIRST_TEMP;
+    }
+
+    uint8_t parsePrimary() {
+        skipSpaces();
+        if ( isDigit(*p) || *p == '.' ) {
+            return parseNumber(false);
+        }
+
+        if ( accept('(') ) {
+            uint8_t reg = parseExpression();
+            expect(')', "')' expected");
+            return reg;
+        }
+
+        Name name = parseName();
+        if ( name.length == 0 ) {
+            fail("value expected");
+            return SHADER_FIRST_TEMP;
+        }
+        if ( accept('(') ) {
+            return parseCall(name);
+        }
+
+        int reg = nameRegister(name);
+        if ( reg < 0 ) {
+            fail("unknown variable");
+            return SHADER_FIRST_TEMP;
+        }
+        return reg;
+    }
+
+    uint8_t parseUnary() {
+        if ( accept('-') ) {
+            // Negative constants are loaded directly
+            skipSpaces();
+            if ( isDigit(*p) || *p == '.' ) {
+                return parseNumber(true);
+            }
+
+            uint8_t a = parseUnary();
+            uint8_t zero = newTemp();
+            emit(SHADER_LDI, zero, 0, 0);
+            // zero was allocated after a: compute into zero, then move the result down if a was a temporary
+            emit(SHADER_SUB, zero, zero, a);
+            if ( isTemp(a) ) {
+                emit(SHADER_MOV, a, zero, 0);
+                release(zero);
+                return a;
+            }
+            return zero;
+        }
+        return parsePrimary();
+    }
+
+    uint8_t parseTerm() {
+        uint8_t a = parseUnary();
+        while ( !error ) {
+            uint8_t op;
+            if ( accept('*') ) {
+                op = SHADER_MUL;
+            }
+            else if ( accept('/') ) {
+                op = SHADER_DIV;
+            }
+            else if ( accept('%') ) {
+                op = SHADER_MOD;
+            }
+            else {
+                break;
+            }
+            a = binary(op, a, parseUnary());
+        }
+        return a;
+    }
+
+    uint8_t parseExpression() {
+        uint8_t a = parseTerm();
+        while ( !error ) {
+            uint8_t op;
+            if ( accept('+') ) {
+                op = SHADER_ADD;
+            }
+            else if ( accept('-') ) {
+                op = SHADER_SUB;
+            }
+            else {
+                break;
+            }
+            a = binary(op, a, parseTerm());
+        }
+        return a;
+    }
+
+    bool parseStatement() {
+        Name name = parseName();
+        if ( name.length == 0 ) {
+            return fail("assignment expected");
+        }
+        if ( !accept('=') ) {
+            return fail("'=' expected");
+        }
+
+        uint8_t value = parseExpression();
+        if ( error ) {
+            return false;
+        }
+
+        int target = nameRegister(name);
+        if ( target >= 0 && target < SHADER_OUT0 ) {
+            return fail("inputs cannot be assigned");
+        }
+        if ( target < 0 ) {
+            // New variable
+            if ( n_variables == MAX_VARIABLES || variableRegister(n_variables) < SHADER_FIRST_TEMP + n_temps - (isTemp(value) ? 1 : 0) ) {
+                return fail("too many variables");
+            }
+            variables[n_variables] = name;
+            target = variableRegister(n_variables++);
+        }
+
+        // Write the result straight into the target when it was computed into a temporary by the last instruction
+        ShaderInstruction *last = program.length > 0 ? &program.code[program.length - 1] : nullptr;
+        if ( isTemp(value) && last && last->d == value && last->op != SHADER_SEL ) {
+            last->d = target;
+        }
+        else if ( value != target ) {
+            emit(SHADER_MOV, target, value, 0);
+        }
+        n_temps = 0;
+        return !error;
+    }
+
+public:
+    ShaderCompiler(ShaderProgram &_program) : source(nullptr), p(nullptr), program(_program), error(nullptr),
+            hsv_outputs(false), rgb_outputs(false), n_variables(0), n_temps(0) {}
+
+    // Returns false if the source is not valid, see getError() and getErrorPosition()
+    bool compile(const char *_source) {
+        source = _source;
+        p = source;
+        error = nullptr;
+        hsv_outputs = false;
+        rgb_outputs = false;
+        n_variables = 0;
+        n_temps = 0;
+        program.length = 0;
+
+        while ( true ) {
+            // Empty statements and comments
+            skipSpaces();
+            if ( *p == '\n' || *p == ';' ) {
+                p++;
+                continue;
+            }
+            if ( *p == '\0' ) {
+                break;
+            }
+
+            if ( !parseStatement() ) {
+                return false;
+            }
+            skipSpaces();
+            if ( *p != '\n' && *p != ';' && *p != '\0' ) {
+                return fail("end of statement expected");
+            }
+        }
+
+        if ( hsv_outputs && rgb_outputs ) {
+            return fail("h, s, v and r, g, b cannot be mixed");
+        }
+        program.mode = rgb_outputs ? SHADER_RGB : SHADER_HSV;
+        return true;
+    }
+
+    const char *getError() const {
+        return error;
+    }
+
+    // Offset of the error in the source
+    uint getErrorPosition() const {
+        return p - source;
+    }
+};
+
+#endif
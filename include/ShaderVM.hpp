@@ -0,0 +1,220 @@
+#ifndef SHADERVM_HPP
+#define SHADERVM_HPP
+
+#include <FastLED.h>
+#include <stdint.h>
+#include <string.h>
+
+// Bytecode of the pixel shaders (see ShaderCompiler.hpp for the language), run for each LED by ShaderAnimation.
+// All the values are fixed point numbers with 8 fractional bits (Q8.8 in 32 bit registers): 256 is 1.0.
+// The programs are straight-line code (no jumps), so the cost of a frame is known when the program is loaded.
+//
+// Registers: inputs, outputs and temporaries. Before each LED, the inputs are set and the outputs get their defaults:
+//   x, y   position of the LED in matrix cells
+//   t      time in seconds
+//   i      index of the LED
+//   hue    hue of the selected color (0 to 1)
+//   h/r    hue (wraps around), or red,   default hue / 0
+//   s/g    saturation,         or green, default 1 / 0
+//   v/b    value,              or blue,  default 1 / 0
+// The outputs are clamped to 0-1 (0-255 raw), except the hue. The arithmetic wraps around on overflow.
+// The angles of sin, cos and tri are in turns: sin(t) has a period of 1 second.
+//
+// Bytecode: version (1), color mode, number of instructions, 0, then 4 bytes per instruction: opcode, destination
+// register, 2 source registers (LDI: the constant, 16 bits little endian).
+enum ShaderRegister : uint8_t {
+    SHADER_X, SHADER_Y, SHADER_T, SHADER_I, SHADER_HUE,
+    SHADER_OUT0, SHADER_OUT1, SHADER_OUT2,
+    SHADER_FIRST_TEMP,
+    SHADER_REGISTERS = 16
+};
+
+enum ShaderOpcode : uint8_t {
+    SHADER_LDI,  // d = constant
+    SHADER_MOV,  // d = a
+    SHADER_ADD,  // d = a + b
+    SHADER_SUB,  // d = a - b
+    SHADER_MUL,  // d = a * b
+    SHADER_DIV,  // d = a / b, 0 if b is 0 (wraps around on overflow)
+    SHADER_MOD,  // d = a modulo b (sign of b), 0 if b is 0
+    SHADER_MIN,  // d = min(a, b)
+    SHADER_MAX,  // d = max(a, b)
+    SHADER_LT,   // d = a < b ? 1 : 0
+    SHADER_SEL,  // d = d != 0 ? a : b
+    SHADER_ABS,  // d = |a|
+    SHADER_SIN,  // d = sin(a turns)
+    SHADER_COS,  // d = cos(a turns)
+    SHADER_TRI,  // d = triangle wave of a, 0 -> 1 -> 0 over one turn
+    SHADER_FRAC, // d = fractional part of a
+    SHADER_OPCODES
+};
+
+enum ShaderColorMode : uint8_t {
+    SHADER_HSV,
+    SHADER_RGB
+};
+
+struct ShaderInstruction {
+    uint8_t op;
+    uint8_t d;
+    uint8_t a;
+    uint8_t b;
+};
+
+static const uint SHADER_MAX_INSTRUCTIONS = 64;
+static const uint8_t SHADER_BYTECODE_VERSION = 1;
+static const uint SHADER_HEADER_SIZE = 4;
+
+// Longest bytecode in hexadecimal (e.g. an MQTT message)
+static const uint SHADER_MAX_HEX_SIZE = 2 * (SHADER_HEADER_SIZE + SHADER_MAX_INSTRUCTIONS * sizeof(ShaderInstruction));
+
+struct ShaderProgram {
+    ShaderColorMode mode;
+    uint length;
+    ShaderInstruction code[SHADER_MAX_INSTRUCTIONS];
+
+    ShaderProgram() : mode(SHADER_HSV), length(0) {}
+
+    // Bytes written, 0 if size is too small
+    size_t toBytecode(uint8_t *out, size_t size) const {
+        size_t bytes = SHADER_HEADER_SIZE + length * sizeof(ShaderInstruction);
+        if ( size < bytes ) {
+            return 0;
+        }
+        out[0] = SHADER_BYTECODE_VERSION;
+        out[1] = mode;
+        out[2] = length;
+        out[3] = 0;
+        memcpy(out + SHADER_HEADER_SIZE, code, length * sizeof(ShaderInstruction));
+        return bytes;
+    }
+
+    // Returns false (and the program is unchanged) if the bytecode is not valid
+    bool fromBytecode(const uint8_t *in, size_t size) {
+        if ( size < SHADER_HEADER_SIZE || in[0] != SHADER_BYTECODE_VERSION || in[1] > SHADER_RGB
+                || in[2] > SHADER_MAX_INSTRUCTIONS || size != SHADER_HEADER_SIZE + in[2] * sizeof(ShaderInstruction) ) {
+            return false;
+        }
+
+        const ShaderInstruction *instructions = (const ShaderInstruction *)(in + SHADER_HEADER_SIZE);
+        for ( uint pc = 0; pc < in[2]; pc++ ) {
+            const ShaderInstruction &instruction = instructions[pc];
+            if ( instruction.op >= SHADER_OPCODES || instruction.d >= SHADER_REGISTERS
+                    || (instruction.op != SHADER_LDI && (instruction.a >= SHADER_REGISTERS || instruction.b >= SHADER_REGISTERS)) ) {
+                return false;
+            }
+        }
+
+        mode = (ShaderColorMode)in[1];
+        length = in[2];
+        memcpy(code, instructions, length * sizeof(ShaderInstruction));
+        return true;
+    }
+
+    // Bytecode as hexadecimal text (e.g. an MQTT message), false if it is not valid
+    bool fromHex(const char *hex, size_t size) {
+        uint8_t bytecode[SHADER_HEADER_SIZE + SHADER_MAX_INSTRUCTIONS * sizeof(ShaderInstruction)];
+        if ( size % 2 != 0 || size / 2 > sizeof(bytecode) ) {
+            return false;
+        }
+
+        for ( size_t i = 0; i < size; i++ ) {
+            uint8_t c = hex[i];
+            uint8_t digit;
+            if ( c >= '0' && c <= '9' ) {
+                digit = c - '0';
+            }
+            else if ( (c | 0x20) >= 'a' && (c | 0x20) <= 'f' ) {
+                digit = (c | 0x20) - 'a' + 10;
+            }
+            else {
+                return false;
+            }
+            bytecode[i / 2] = (i % 2 == 0) ? digit << 4 : bytecode[i / 2] | digit;
+        }
+        return fromBytecode(bytecode, size / 2);
+    }
+};
+
+class ShaderVM {
+private:
+    int32_t registers[SHADER_REGISTERS];
+
+    static uint8_t clamp(int32_t value) {
+        return value < 0 ? 0 : (value > 255 ? 255 : value);
+    }
+
+public:
+    ShaderVM() {
+        memset(registers, 0, sizeof(registers));
+    }
+
+    // Inputs that are the same for every LED of the frame
+    void beginFrame(int32_t t, int32_t hue) {
+        registers[SHADER_T] = t;
+        registers[SHADER_HUE] = hue;
+    }
+
+    // Color of the LED at (x, y), in matrix cells * 256
+    CRGB shade(const ShaderProgram &program, int32_t x, int32_t y, uint index) {
+        int32_t *r = registers;
+        r[SHADER_X] = x;
+        r[SHADER_Y] = y;
+        r[SHADER_I] = (int32_t)index << 8;
+        if ( program.mode == SHADER_HSV ) {
+            r[SHADER_OUT0] = r[SHADER_HUE];
+            r[SHADER_OUT1] = 255;
+            r[SHADER_OUT2] = 255;
+        }
+        else {
+            r[SHADER_OUT0] = 0;
+            r[SHADER_OUT1] = 0;
+            r[SHADER_OUT2] = 0;
+        }
+
+        const ShaderInstruction *instruction = program.code;
+        const ShaderInstruction *end = instruction + program.length;
+        for ( ; instruction < end; instruction++ ) {
+            int32_t a = r[instruction->a & (SHADER_REGISTERS - 1)];
+            int32_t b = r[instruction->b & (SHADER_REGISTERS - 1)];
+            int32_t &d = r[instruction->d];
+
+            switch ( instruction->op ) {
+                case SHADER_LDI: d = (int16_t)(instruction->a | (instruction->b << 8)); break;
+                case SHADER_MOV: d = a; break;
+                case SHADER_ADD: d = (int32_t)((uint32_t)a + (uint32_t)b); break;
+                case SHADER_SUB: d = (int32_t)((uint32_t)a - (uint32_t)b); break;
+                case SHADER_MUL: d = (int32_t)((uint32_t)a * (uint32_t)b) >> 8; break;
+                // INT32_MIN / -1 overflows (it traps on some CPUs): the division by -1 is a wrapping negation
+                case SHADER_DIV: {
+                    uint32_t shifted = (uint32_t)a << 8;
+                    d = b == 0 ? 0 : (b == -1 ? (int32_t)(0u - shifted) : (int32_t)shifted / b);
+                    break;
+                }
+                case SHADER_MOD: {
+                    int32_t m = b == 0 || b == -1 ? 0 : a % b;
+                    d = (m != 0 && (m ^ b) < 0) ? m + b : m;
+                    break;
+                }
+                case SHADER_MIN: d = a < b ? a : b; break;
+                case SHADER_MAX: d = a > b ? a : b; break;
+                case SHADER_LT: d = a < b ? 256 : 0; break;
+                case SHADER_SEL: d = d ? a : b; break;
+                case SHADER_ABS: d = a < 0 ? (int32_t)(0u - (uint32_t)a) : a; break;
+                case SHADER_SIN: d = ((int32_t)sin8(a) - 128) * 2; break;
+                case SHADER_COS: d = ((int32_t)sin8(a + 64) - 128) * 2; break;
+                case SHADER_TRI: d = triwave8(a); break;
+                case SHADER_FRAC: d = a & 255; break;
+            }
+        }
+
+        if ( program.mode == SHADER_HSV ) {
+            CRGB color;
+            hsv2rgb_rainbow(CHSV(r[SHADER_OUT0], clamp(r[SHADER_OUT1]), clamp(r[SHADER_OUT2])), color);
+            return color;
+        }
+        return CRGB(clamp(r[SHADER_OUT0]), clamp(r[SHADER_OUT1]), clamp(r[SHADER_OUT2]));
+    }
+};
+
+#endif
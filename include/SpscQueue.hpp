@@ -0,0 +1,57 @@
+#ifndef SPSCQUEUE_HPP
+#define SPSCQUEUE_HPP
+
+#include <Arduino.h>
+#include <atomic>
+
+// Fixed size single producer / single consumer queue, without locks nor allocations.
+// The producer only writes the head and the consumer only writes the tail, so push() and pop() can be called from
+// different contexts (e.g. a network callback and the frame loop). SIZE must be a power of 2, SIZE - 1 items fit.
+template<typename T, uint SIZE>
+class SpscQueue {
+private:
+    static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "The queue size must be a power of 2");
+
+    T items[SIZE];
+    std::atomic<uint> head; // Next item written by the producer
+    std::atomic<uint> tail; // Next item read by the consumer
+    uint32_t dropped;
+
+public:
+    SpscQueue() : head(0), tail(0), dropped(0) {}
+
+    // Producer side, returns false (and the item is dropped) when the queue is full
+    bool push(const T &item) {
+        uint h = head.load(std::memory_order_relaxed);
+        uint next = (h + 1) & (SIZE - 1);
+        if ( next == tail.load(std::memory_order_acquire) ) {
+            dropped++;
+            return false;
+        }
+        items[h] = item;
+        head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side, returns false when the queue is empty
+    bool pop(T &item) {
+        uint t = tail.load(std::memory_order_relaxed);
+        if ( t == head.load(std::memory_order_acquire) ) {
+            return false;
+        }
+        item = items[t];
+        tail.store((t + 1) & (SIZE - 1), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+
+    // Items rejected by push() because the queue was full (updated by the producer)
+    uint32_t getDropped() const {
+        return dropped;
+    }
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef WS2812ENCODER_HPP
+#define WS2812ENCODER_HPP
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+// Encodes LED colors into the UART byte stream that generates the WS2812 waveform (same method as NeoPixelBus).
+// The UART runs at 3.2 Mbaud, 6N1, with an inverted TX line: one UART frame (start bit, 6 data bits, stop bit) lasts
+// 2.5 us and produces 2 WS2812 bits of 1.25 us each:
+//   bit 0: high 312.5 ns, low 937.5 ns      bit 1: high 937.5 ns, low 312.5 ns
+// The inverted start bit gives the rising edge of the first bit, the inverted stop bit the low end of the second.
+// The line stays low (the WS2812 reset/latch) when the UART is idle.
+//
+// The encoding is table-driven: each nibble of a color byte becomes 2 UART bytes, so a LED takes 12 UART bytes.
+
+// UART byte for the 2 WS2812 bits (first bit in bit 1)
+constexpr uint8_t ws2812UartSymbol(uint8_t bits) {
+    return (bits & 2 ? 0b000100 : 0b000111) | (bits & 1 ? 0b000000 : 0b110000);
+}
+
+struct Ws2812UartTable {
+    // Nibble -> 2 UART bytes, the first one to be sent in the low byte
+    uint16_t symbols[16];
+};
+
+constexpr Ws2812UartTable makeWs2812UartTable() {
+    Ws2812UartTable table = {};
+    for ( uint nibble = 0; nibble < 16; nibble++ ) {
+        table.symbols[nibble] = ws2812UartSymbol(nibble >> 2) | (ws2812UartSymbol(nibble & 3) << 8);
+    }
+    return table;
+}
+
+static constexpr Ws2812UartTable ws2812_uart_table = makeWs2812UartTable();
+
+static const uint WS2812_UART_BYTES_PER_LED = 12;
+
+// Channel of the LED colors sent in position 0, 1 and 2 for a FastLED color order (e.g. GRB: 1, 0, 2)
+inline void ws2812ChannelOrder(uint order, uint8_t channels[3]) {
+    channels[0] = (order >> 6) & 3;
+    channels[1] = (order >> 3) & 3;
+    channels[2] = order & 3;
+}
+
+// Encodes count LEDs into count * WS2812_UART_BYTES_PER_LED bytes (written as 16 bit words, little endian).
+// scale is the brightness and color correction of each channel (as CLEDController::computeAdjustment()).
+inline void ws2812EncodeUart(const CRGB *leds, uint count, uint order, const CRGB &scale, uint16_t *out) {
+    uint8_t channels[3];
+    ws2812ChannelOrder(order, channels);
+    uint8_t scale0 = scale.raw[channels[0]];
+    uint8_t scale1 = scale.raw[channels[1]];
+    uint8_t scale2 = scale.raw[channels[2]];
+
+    for ( uint i = 0; i < count; i++ ) {
+        const uint8_t *raw = leds[i].raw;
+        uint8_t byte0 = scale8(raw[channels[0]], scale0);
+        uint8_t byte1 = scale8(raw[channels[1]], scale1);
+        uint8_t byte2 = scale8(raw[channels[2]], scale2);
+
+        out[0] = ws2812_uart_table.symbols[byte0 >> 4];
+        out[1] = ws2812_uart_table.symbols[byte0 & 0x0F];
+        out[2] = ws2812_uart_table.symbols[byte1 >> 4];
+        out[3] = ws2812_uart_table.symbols[byte1 & 0x0F];
+        out[4] = ws2812_uart_table.symbols[byte2 >> 4];
+        out[5] = ws2812_uart_table.symbols[byte2 & 0x0F];
+        out += 6;
+    }
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef WS2812UART1_HPP
+#define WS2812UART1_HPP
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include "Ws2812Encoder.hpp"
+
+// Non-blocking WS2812 output on UART1 (TX on GPIO2 / D4 only).
+// show() encodes the frame into a buffer (see Ws2812Encoder.hpp) and returns: the UART FIFO is refilled from the
+// TX FIFO empty interrupt while the next frame is computed. FastLED.show() instead keeps the interrupts disabled
+// during the whole transmission (about 13.5 ms for 451 LEDs).
+// show() waits only if the previous frame is still being sent, including the reset time that latches the colors.
+//
+// The UART interrupt is shared by UART0 and UART1: the Serial receive interrupt is disabled (Serial can still print).
+template<uint N_LEDS>
+class Ws2812Uart1 {
+private:
+    static const uint32_t BAUD_RATE = 3200000;
+    static const uint FIFO_SIZE = 128;
+    static const uint FIFO_THRESHOLD = 32; // The interrupt refills the FIFO when fewer bytes are waiting
+    static const uint UART_BYTE_NS = 2500;
+    static const uint RESET_US = 300; // Latch time, WS2812B need more than 280 us
+
+    static const uint BUFFER_SIZE = N_LEDS * WS2812_UART_BYTES_PER_LED;
+
+    uint order;
+    uint16_t buffer[BUFFER_SIZE / 2];
+
+    // Written by the interrupt
+    const uint8_t *volatile next_byte;
+    const uint8_t *end_byte;
+
+    // The line is free (frame sent and latched) after this time, set by the interrupt when the last bytes are queued
+    volatile unsigned long frame_end_us;
+
+    static void IRAM_ATTR isr(void *arg) {
+        Ws2812Uart1 *self = (Ws2812Uart1 *)arg;
+
+        if ( USIS(1) & (1 << UIFE) ) {
+            const uint8_t *byte = self->next_byte;
+            uint room = FIFO_SIZE - ((USS(1) >> USTXC) & 0xFF);
+            const uint8_t *end = byte + room < self->end_byte ? byte + room : self->end_byte;
+
+            while ( byte < end ) {
+                USF(1) = *byte++;
+            }
+            self->next_byte = byte;
+
+            if ( byte == self->end_byte ) {
+                // Everything is in the FIFO
+                USIE(1) &= ~(1 << UIFE);
+                uint queued = (USS(1) >> USTXC) & 0xFF;
+                self->frame_end_us = micros() + queued * UART_BYTE_NS / 1000 + RESET_US;
+            }
+            USIC(1) = (1 << UIFE);
+        }
+
+        // Serial (UART0) interrupts are not used, make sure they do not fire again
+        USIC(0) = USIS(0);
+    }
+
+public:
+    // order: FastLED color order of the LEDs, e.g. GRB
+    Ws2812Uart1(uint _order) : order(_order), next_byte(nullptr), end_byte(nullptr), frame_end_us(0) {}
+
+    void begin() {
+        Serial1.begin(BAUD_RATE, SERIAL_6N1, SERIAL_TX_ONLY);
+
+        // Inverted TX: the UART idle level (high) becomes the WS2812 reset level (low)
+        USC0(1) |= (1 << UCTXI);
+        USC1(1) = (FIFO_THRESHOLD << UCFET);
+
+        ETS_UART_INTR_DISABLE();
+        USIE(0) = 0;
+        USIC(0) = 0xFFFF;
+        USIE(1) = 0;
+        USIC(1) = 0xFFFF;
+        ETS_UART_INTR_ATTACH(isr, this);
+        ETS_UART_INTR_ENABLE();
+    }
+
+    // True while a frame is being sent or latched
+    bool busy() const {
+        return next_byte != end_byte || (long)(micros() - frame_end_us) < 0;
+    }
+
+    // Sends the LEDs with the given brightness and color correction of each channel
+    void show(const CRGB *leds, const CRGB &scale) {
+        while ( busy() ) {
+            yield();
+        }
+
+        ws2812EncodeUart(leds, N_LEDS, order, scale, buffer);
+
+        const uint8_t *bytes = (const uint8_t *)buffer;
+        end_byte = bytes + BUFFER_SIZE;
+        frame_end_us = micros() + (unsigned long)BUFFER_SIZE * UART_BYTE_NS / 1000 + RESET_US;
+        next_byte = bytes;
+
+        // The interrupt fires at once since the FIFO is empty
+        USIC(1) = (1 << UIFE);
+        USIE(1) |= (1 << UIFE);
+    }
+};
+
+#endif
@@ -1,43 +1,45 @@
 #ifndef LEDMAP_HPP
 #define LEDMAP_HPP
 
+#include <stdint.h>
 #include "config.hpp"
+#include "LedGeometry.hpp"
+#include "LedLayout.hpp"
 
-int ledmap_vertical[LED_MATRIX_ROWS][LED_MATRIX_COLS] = {
-33,85,89,141,145,197,201,253,257,309,313,365,369,421,425,
-34,84,90,140,146,196,202,252,258,308,314,364,370,420,426,
-35,83,91,139,147,195,203,251,259,307,315,363,371,419,427,
-36,82,92,138,148,194,204,250,260,306,316,362,372,418,428,
-37,81,93,137,149,193,205,249,261,305,317,361,373,417,429,
-38,80,94,136,150,192,206,248,262,304,318,360,374,416,430,
-39,79,95,135,151,191,207,247,263,303,319,359,375,415,431,
-40,78,96,134,152,190,208,246,264,302,320,358,376,414,432,
-41,77,97,133,153,189,209,245,265,301,321,357,377,413,433,
-42,76,98,132,154,188,210,244,266,300,322,356,378,412,434,
-43,75,99,131,155,187,211,243,267,299,323,355,379,411,435,
-44,74,100,130,156,186,212,242,268,298,324,354,380,410,436,
-45,73,101,129,157,185,213,241,269,297,325,353,381,409,437,
-46,72,102,128,158,184,214,240,270,296,326,352,382,408,438,
-47,71,103,127,159,183,215,239,271,295,327,351,383,407,439,
-48,70,104,126,160,182,216,238,272,294,328,350,384,406,440,
-49,69,105,125,161,181,217,237,273,293,329,349,385,405,441,
-50,68,106,124,162,180,218,236,274,292,330,348,386,404,442,
-51,67,107,123,163,179,219,235,275,291,331,347,387,403,443,
-52,66,108,122,164,178,220,234,276,290,332,346,388,402,444,
-53,65,109,121,165,177,221,233,277,289,333,345,389,401,445,
-54,64,110,120,166,176,222,232,278,288,334,344,390,400,446,
-55,63,111,119,167,175,223,231,279,287,335,343,391,399,447,
-56,62,112,118,168,174,224,230,280,286,336,342,392,398,448,
-57,61,113,117,169,173,225,229,281,285,337,341,393,397,449
-};
-
-int ledmap_horizontal[2][21] = {
-58,59,60,114,115,116,170,171,172,226,227,228,282,283,284,338,339,340,394,395,396,
-86,87,88,142,143,144,198,199,200,254,255,256,310,311,312,366,367,368,422,423,424
-};
-
-
-
-//int ledmap[1][100] = {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40,41,42,43,44,45,46,47,48,49,50,51,52,53,54,55,56,57,58,59,60,61,62,63,64,65,66,67,68,69,70,71,72,73,74,75,76,77,78,79,80,81,82,83,84,85,86,87,88,89,90,91,92,93,94,95,96,97,98,99};
-
-#endif
\ No newline at end of file
+// Outdoor lights (see electronics/leds-outdoor.png): the strip starts with 33 unused LEDs, then goes down and up
+// the 15 vertical segments of 25 LEDs. Two vertical segments are connected by a horizontal segment of 3 LEDs,
+// alternately at the bottom (row 0 of ledmap_horizontal) and at the top (row 1 of ledmap_horizontal).
+constexpr LedLayout ledlayout_vertical = LedLayout::columns(33, 28).serpentine();
+constexpr LedLayout ledlayout_horizontal = LedLayout::rows(58, 28).runs(3, 56);
+
+// The maps are generated at compile time and stored in flash, read them with pgm_read_word()
+const LedMap<LED_MATRIX_ROWS, LED_MATRIX_COLS> ledmap_vertical PROGMEM = makeLedMap<LED_MATRIX_ROWS, LED_MATRIX_COLS>(ledlayout_vertical);
+const LedMap<2, 21> ledmap_horizontal PROGMEM = makeLedMap<2, 21>(ledlayout_horizontal);
+const LedInverseMap<NUM_LEDS> ledmap_vertical_inverse PROGMEM = makeLedInverseMap<NUM_LEDS, LED_MATRIX_ROWS, LED_MATRIX_COLS>(ledlayout_vertical);
+
+// Map of the LED matrix used by the animations, and matrix position of each LED (LED_NOT_MAPPED outside the matrix)
+const uint16_t *const ledmap_matrix = ledmap_vertical.index;
+const uint16_t *const ledmap_matrix_inverse = ledmap_vertical_inverse.position;
+
+// Position of the LEDs: the vertical segments are the matrix, each horizontal segment joins the ends of the two columns
+// it connects (the LEDs before and after it on the strip), half a cell beyond the matrix
+constexpr LedGeometry<NUM_LEDS> makeLedGeometry() {
+    LedGeometry<NUM_LEDS> geometry;
+    geometry.placeMatrix<LED_MATRIX_ROWS, LED_MATRIX_COLS>(ledlayout_vertical);
+
+    for ( uint row = 0; row < 2; row++ ) {
+        for ( uint col = 0; col < 21; col += 3 ) {
+            uint first = ledlayout_horizontal.index(row, col, 2, 21);
+            LedPoint from = geometry.points[first - 1];
+            LedPoint to = geometry.points[first + 3];
+            int16_t beyond = from.y == 0 ? -LED_CELL / 2 : LED_CELL / 2;
+            geometry.placeLine(first, 3, { from.x, (int16_t)(from.y + beyond) }, { to.x, (int16_t)(to.y + beyond) });
+        }
+    }
+    return geometry;
+}
+
+// Kept in RAM (4 bytes per LED): it is read for each LED at every frame of the spatial animations
+const LedGeometry<NUM_LEDS> ledgeometry = makeLedGeometry();
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef RGBHSV_HPP
+#define RGBHSV_HPP
+
 // Code by Leszek Szary
 // https://stackoverflow.com/a/14733008
 
@@ -15,7 +18,7 @@ typedef struct HsvColor
     unsigned char v;
 } HsvColor;
 
-RgbColor HsvToRgb(HsvColor hsv)
+inline RgbColor HsvToRgb(HsvColor hsv)
 {
     RgbColor rgb;
     unsigned char region, remainder, p, q, t;
@@ -60,7 +63,7 @@ RgbColor HsvToRgb(HsvColor hsv)
     return rgb;
 }
 
-HsvColor RgbToHsv(RgbColor rgb)
+inline HsvColor RgbToHsv(RgbColor rgb)
 {
     HsvColor hsv;
     unsigned char rgbMin, rgbMax;
@@ -91,4 +94,6 @@ HsvColor RgbToHsv(RgbColor rgb)
         hsv.h = 171 + 43 * (rgb.r - rgb.g) / (rgbMax - rgbMin);
 
     return hsv;
-}
\ No newline at end of file
+}
+
+#endif
@@ -0,0 +1,360 @@
+// Headless benchmark of the animations, runs on the host with the native stand-ins for FastLED, SPIFFS and Arduino.
+// Build and run from the project folder (SPIFFS is read from the "data" folder):
+//   pio run -e native && .pio/build/native/program [frames] [recording]
+// The LED output benchmarks (encoding, hash, power) run on black LEDs, or on the frames of a recording made by
+// native/record in the order of the strip.
+
+#include <Arduino.h>
+#include "config.hpp"
+
+#include <FS.h>
+#include <FastLED.h>
+#include <chrono>
+#include <new>
+#include <stdlib.h>
+#include <vector>
+
+#include "Arena.hpp"
+#include "Compositor.hpp"
+#include "FrameBuffer.hpp"
+#include "FrameChangeDetector.hpp"
+#include "FrameRecorder.hpp"
+#include "Metrics.hpp"
+#include "PowerLimiter.hpp"
+#include "Ws2812Encoder.hpp"
+#include "RunningDots.hpp"
+#include "ScrollingPicture.hpp"
+#include "GreenChristmas.hpp"
+#include "PlasmaWaves.hpp"
+#include "MoviePlayer.hpp"
+#include "ShaderAnimation.hpp"
+
+#include "ledmap.hpp"
+
+// Count the heap allocations
+static unsigned long allocations = 0;
+
+void *operator new(size_t size) {
+    allocations++;
+    void *p = malloc(size);
+    if ( !p ) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+struct MatrixSize {
+    uint rows;
+    uint cols;
+};
+
+// Serpentine columns, as on the outdoor installation
+std::vector<uint16_t> serpentineMap(uint rows, uint cols) {
+    std::vector<uint16_t> map(rows * cols);
+    for ( uint row = 0; row < rows; row++ ) {
+        for ( uint col = 0; col < cols; col++ ) {
+            map[row * cols + col] = col * rows + ( (col % 2) == 0 ? row : rows - 1 - row );
+        }
+    }
+    return map;
+}
+
+template<typename F>
+void bench(const char *name, const MatrixSize &size, uint frames, F nextFrame) {
+    // Warm up (also loads the first columns of the pictures)
+    for ( uint i = 0; i < 10; i++ ) {
+        nextFrame();
+    }
+
+    unsigned long allocations_start = allocations;
+    auto start = std::chrono::steady_clock::now();
+
+    for ( uint i = 0; i < frames; i++ ) {
+        nextFrame();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    double ns_per_frame = std::chrono::duration<double, std::nano>(end - start).count() / frames;
+    double allocs_per_frame = (double)(allocations - allocations_start) / frames;
+
+    printf("%-20s %4ux%-4u %12.0f %14.2f\n", name, size.rows, size.cols, ns_per_frame, allocs_per_frame);
+}
+
+// Decodes the UART stream produced by ws2812EncodeUart() as the WS2812 would see it, and checks the pulse widths
+// against the WS2812B datasheet (T0H 400 ns, T1H 800 ns, T0L 850 ns, T1L 450 ns, all +-150 ns).
+// Returns false if a pulse is out of spec or a decoded byte differs from the scaled LED color.
+bool checkWs2812Encoder() {
+    const uint count = NUM_LEDS;
+    const uint order = 0102; // GRB
+    const CRGB scale(255, 176, 240);
+
+    std::vector<CRGB> leds(count);
+    for ( uint i = 0; i < count; i++ ) {
+        leds[i] = CRGB(random8(), random8(), random8());
+    }
+    leds[0] = CRGB(0, 0, 0);
+    leds[1] = CRGB(255, 255, 255);
+
+    std::vector<uint16_t> stream(count * WS2812_UART_BYTES_PER_LED / 2);
+    ws2812EncodeUart(leds.data(), count, order, scale, stream.data());
+
+    // Line level for each UART bit (312.5 ns): start bit, 6 data bits (LSB first), stop bit, inverted
+    std::vector<bool> line;
+    const uint8_t *bytes = (const uint8_t *)stream.data();
+    for ( uint i = 0; i < stream.size() * 2; i++ ) {
+        line.push_back(true);
+        for ( uint bit = 0; bit < 6; bit++ ) {
+            line.push_back(!((bytes[i] >> bit) & 1));
+        }
+        line.push_back(false);
+    }
+
+    // Measure the high and low pulses, decode the bits
+    std::vector<uint8_t> decoded;
+    uint8_t current = 0;
+    uint n_bits = 0;
+    for ( size_t pos = 0; pos < line.size(); ) {
+        uint high = 0;
+        uint low = 0;
+        while ( pos < line.size() && line[pos] ) { high++; pos++; }
+        while ( pos < line.size() && !line[pos] ) { low++; pos++; }
+
+        uint high_ns = high * 3125 / 10;
+        uint low_ns = low * 3125 / 10;
+        bool bit = high_ns >= 650 && high_ns <= 950;
+        bool zero = high_ns >= 250 && high_ns <= 550;
+        bool last = pos == line.size();
+        bool low_ok = last || ( bit ? low_ns >= 300 && low_ns <= 600 : low_ns >= 700 && low_ns <= 1000 );
+        if ( !(bit || zero) || !low_ok ) {
+            printf("WS2812 encoder: pulse out of spec at bit %u (high %u ns, low %u ns)\n", n_bits, high_ns, low_ns);
+            return false;
+        }
+
+        current = (current << 1) | bit;
+        if ( ++n_bits % 8 == 0 ) {
+            decoded.push_back(current);
+        }
+    }
+
+    uint8_t channels[3];
+    ws2812ChannelOrder(order, channels);
+    for ( uint i = 0; i < count * 3; i++ ) {
+        uint channel = channels[i % 3];
+        uint8_t expected = scale8(leds[i / 3].raw[channel], scale.raw[channel]);
+        if ( i >= decoded.size() || decoded[i] != expected ) {
+            printf("WS2812 encoder: byte %u is wrong\n", i);
+            return false;
+        }
+    }
+
+    printf("WS2812 encoder: %u LEDs bit-exact, pulses within the WS2812B timing\n\n", count);
+    return true;
+}
+
+// Frames of a recording, one after the other. Returns false if the file is not a recording of NUM_LEDS LEDs.
+bool loadRecording(const char *path, std::vector<CRGB> &recording) {
+    fs::File file(fopen(path, "rb"));
+    std::vector<CRGB> frame(NUM_LEDS);
+    FrameReplayer replayer(frame.data(), NUM_LEDS);
+    if ( !file || !replayer.begin(file) || replayer.getCount() != NUM_LEDS || replayer.getCols() != 0 ) {
+        return false;
+    }
+
+    while ( replayer.next(file) ) {
+        recording.insert(recording.end(), frame.begin(), frame.end());
+    }
+    return !recording.empty();
+}
+
+int main(int argc, char **argv) {
+    uint frames = argc > 1 ? atoi(argv[1]) : 2000;
+
+    std::vector<CRGB> recording;
+    if ( argc > 2 ) {
+        if ( !loadRecording(argv[2], recording) ) {
+            printf("%s is not a recording of %u LEDs in strip order\n", argv[2], NUM_LEDS);
+            return 1;
+        }
+        printf("LED output benchmarks on the %u frames of %s\n\n", (uint)(recording.size() / NUM_LEDS), argv[2]);
+    }
+
+    if ( !checkWs2812Encoder() ) {
+        return 1;
+    }
+
+    const MatrixSize sizes[] = {
+        { LED_MATRIX_ROWS, LED_MATRIX_COLS },
+        { 1, 80 },
+        { 32, 32 },
+        { 64, 64 }
+    };
+
+    printf("%-20s %9s %12s %14s\n", "benchmark", "size", "ns/frame", "allocs/frame");
+
+    for ( const MatrixSize &size : sizes ) {
+        uint num_leds = size.rows * size.cols;
+        std::vector<CRGB> leds(num_leds);
+        std::vector<uint16_t> map = serpentineMap(size.rows, size.cols);
+        FrameBuffer ledMatrix(leds.data(), map.data(), size.rows, size.cols);
+
+        random16_set_seed(1337);
+
+        // Buffers of the animations, allocated before the measurements as on the ESP8266
+        std::vector<uint8_t> arena_memory(RunningDots::arenaSize(size.rows, size.cols)
+            + ScrollingPicture::arenaSize(size.rows, size.cols) + GreenChristmas::arenaSize(size.rows, size.cols)
+            + PlasmaWaves::arenaSize(size.rows, size.cols) + MoviePlayer::arenaSize(size.rows, size.cols)
+            + ShaderAnimation::arenaSize(size.rows, size.cols));
+        Arena arena(arena_memory.data(), arena_memory.size());
+
+        RunningDots runningDots(ledMatrix, arena, 5, 2);
+        bench("RunningDots", size, frames, [&]() { runningDots.nextFrame(); });
+
+        ScrollingPicture scrollingPicture(ledMatrix, arena);
+        scrollingPicture.loadNextBMP();
+        bench("ScrollingPicture", size, frames, [&]() { scrollingPicture.nextFrame(); });
+
+        GreenChristmas greenChristmas(ledMatrix, arena);
+        bench("GreenChristmas", size, frames, [&]() { greenChristmas.nextFrame(); });
+
+        // Sampled at the matrix cells
+        PlasmaWaves plasmaWaves(ledMatrix, arena);
+        bench("PlasmaWaves", size, frames, [&]() { plasmaWaves.nextFrame(); });
+
+        // Movies of this matrix size in the data folder (black frames if there is none)
+        MoviePlayer moviePlayer(ledMatrix, arena);
+        moviePlayer.nextImage();
+        bench("MoviePlayer", size, frames, [&]() { moviePlayer.nextFrame(); });
+
+        ShaderAnimation shaderAnimation(ledMatrix, arena);
+        bench("ShaderAnimation", size, frames, [&]() { shaderAnimation.nextFrame(); });
+
+        // Separate matrix buffer copied to the LEDs through the map (what render-through avoids)
+        std::vector<CRGB> matrix(num_leds);
+        bench("ledmap remap", size, frames, [&]() {
+            for ( uint i = 0; i < num_leds; i++ ) {
+                leds[ map[i] ] = matrix[i];
+            }
+        });
+    }
+
+    // The real outdoor ledmap
+    std::vector<CRGB> leds(NUM_LEDS);
+
+    // Spatial animation over the position of every LED, in the order of the strip
+    std::vector<uint8_t> arena_memory(PlasmaWaves::arenaSize(LED_MATRIX_ROWS, LED_MATRIX_COLS));
+    Arena arena(arena_memory.data(), arena_memory.size());
+    FrameBuffer ledGeometry(leds.data(), ledmap_matrix, LED_MATRIX_ROWS, LED_MATRIX_COLS, ledgeometry.points, NUM_LEDS);
+    PlasmaWaves plasmaWaves(ledGeometry, arena);
+    bench("PlasmaWaves geometry", { 1, NUM_LEDS }, frames, [&]() { plasmaWaves.nextFrame(); });
+
+    std::vector<CRGB> matrix(LED_MATRIX_ROWS * LED_MATRIX_COLS);
+    bench("ledmap_vertical", { LED_MATRIX_ROWS, LED_MATRIX_COLS }, frames, [&]() {
+        for ( uint row = 0; row < LED_MATRIX_ROWS; row++ ) {
+            for ( uint col = 0; col < LED_MATRIX_COLS; col++ ) {
+                leds[ pgm_read_word(&ledmap_vertical.index[row * LED_MATRIX_COLS + col]) ] = matrix[row * LED_MATRIX_COLS + col];
+            }
+        }
+    });
+
+
+    // Speed of the shader interpreter, which decides how long the shaders can be
+    printf("\n%-20s %12s %14s\n", "shader", "pixels/s", "instructions/s");
+    const char *const shaders[] = {
+        SHADER_DEFAULT_SOURCE,
+        "v = sin(x / 8 + t) * sin(y / 8 - t / 2) * 0.5 + 0.5",
+        "d = abs(x - 7) + abs(y - 12); h = d / 16 + t / 3; v = if(lt(frac(d / 4 - t), 0.5), 1, 0.2)",
+        "r = tri(x / 15 + t / 4); g = tri(y / 25 + t / 5); b = max(0, sin(x / 8 + y / 8 + t)) * 0.8"
+    };
+    for ( const char *source : shaders ) {
+        ShaderProgram program;
+        ShaderCompiler compiler(program);
+        if ( !compiler.compile(source) ) {
+            printf("Shader error at %u: %s\n", compiler.getErrorPosition(), compiler.getError());
+            return 1;
+        }
+
+        ShaderVM vm;
+        uint32_t sink = 0;
+        const uint pixels = frames * LED_MATRIX_ROWS * LED_MATRIX_COLS;
+        auto start = std::chrono::steady_clock::now();
+        for ( uint frame = 0; frame < frames; frame++ ) {
+            vm.beginFrame(frame * 256 / 24, 160);
+            for ( uint row = 0; row < LED_MATRIX_ROWS; row++ ) {
+                for ( uint col = 0; col < LED_MATRIX_COLS; col++ ) {
+                    sink += vm.shade(program, col * LED_CELL, row * LED_CELL, row * LED_MATRIX_COLS + col).r;
+                }
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        printf("%2u instructions %9.0f %14.0f\n", program.length, pixels / seconds, pixels * program.length / seconds);
+        if ( sink == 1 ) {
+            printf("\n");
+        }
+    }
+    printf("\n");
+
+    // LEDs sent to the strip: the recorded frames in turn, or black LEDs
+    if ( recording.empty() ) {
+        recording.assign(NUM_LEDS, CRGB(0, 0, 0));
+    }
+    size_t recorded_frame = 0;
+    auto nextRecordedFrame = [&]() {
+        const CRGB *frame = recording.data() + recorded_frame;
+        recorded_frame = recorded_frame + NUM_LEDS < recording.size() ? recorded_frame + NUM_LEDS : 0;
+        return frame;
+    };
+
+    // Encoding of the frame for the UART1 output
+    std::vector<uint16_t> stream(NUM_LEDS * WS2812_UART_BYTES_PER_LED / 2);
+    bench("ws2812 uart encode", { 1, NUM_LEDS }, frames, [&]() { ws2812EncodeUart(nextRecordedFrame(), NUM_LEDS, 0102, CRGB(255, 176, 240), stream.data()); });
+
+    // Pass over the LEDs before show(): frame hash alone, and with the power estimation
+    uint32_t sink = 0;
+    PowerLimiter<3> powerLimiter(151, 2500, 6000);
+    bench("frame hash", { 1, NUM_LEDS }, frames, [&]() { sink += FrameChangeDetector::hash(nextRecordedFrame(), NUM_LEDS); });
+    bench("hash + power", { 1, NUM_LEDS }, frames, [&]() { sink += powerLimiter.scan(nextRecordedFrame(), NUM_LEDS); });
+
+    // Overlays: none visible (no pass), sparkles, sparkles over a crossfade
+    const CRGB *recorded = nextRecordedFrame();
+    std::vector<CRGB> base(recorded, recorded + NUM_LEDS);
+    std::vector<CRGB> composed(NUM_LEDS);
+    std::vector<CRGB> snapshot(NUM_LEDS);
+    Compositor<SparkleLayer, CrossfadeLayer, FadeLayer> compositor(base.data(), composed.data(), NUM_LEDS, SparkleLayer(ledmap_matrix_inverse),
+        CrossfadeLayer(snapshot.data(), NUM_LEDS), FadeLayer());
+    bench("compose transparent", { 1, NUM_LEDS }, frames, [&]() { sink += compositor.compose(50)[0].r; });
+    compositor.get<SparkleLayer>().setDensity(20000);
+    bench("compose sparkles", { 1, NUM_LEDS }, frames, [&]() { sink += compositor.compose(50)[0].r; });
+    bench("compose + crossfade", { 1, NUM_LEDS }, frames, [&]() {
+        if ( compositor.get<CrossfadeLayer>().isDone() ) {
+            compositor.get<CrossfadeLayer>().start(composed.data(), 50);
+        }
+        sink += compositor.compose(50)[0].r;
+    });
+
+    // JSON snapshot of the metrics, formatted in the time left before a frame
+    const char *const counter_names[] = { "frames", "shown", "dropped", "overruns", "mqtt_reconnects" };
+    const char *const gauge_names[] = { "show_us", "loop_us", "rssi", "free_heap", "uptime" };
+    Metrics<5, 5> metrics(counter_names, gauge_names);
+    char json[256];
+    bench("metrics json", { 1, 1 }, frames, [&]() {
+        metrics.add(0);
+        metrics.setMax(0, sink & 0xFFF);
+        metrics.set(3, 30000 - (sink & 0xFF));
+        sink += metrics.formatJson(json, sizeof(json));
+        metrics.resetPeaks();
+    });
+    if ( sink == 1 ) {
+        printf("\n");
+    }
+
+    return 0;
+}
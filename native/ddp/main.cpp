@@ -0,0 +1,79 @@
+// Host test of the DDP receiver: listens on DDP_PORT, writes the frames into leds[] through the outdoor ledmap (as
+// on the ESP8266) and prints the received frames as text. Exits when the sender has stopped for DDP_TIMEOUT_MS.
+// Build and run from the project folder, then send frames with tools/ddp_send.py:
+//   pio run -e native_ddp && .pio/build/native_ddp/program [--raw]
+
+#include <Arduino.h>
+#include "config.hpp"
+
+#include <FastLED.h>
+
+#include "DdpReceiver.hpp"
+#include "FrameBuffer.hpp"
+#include "FrameChangeDetector.hpp"
+
+#include "ledmap.hpp"
+
+CRGB leds[NUM_LEDS];
+FrameBuffer ledMatrix(leds, ledmap_matrix, LED_MATRIX_ROWS, LED_MATRIX_COLS);
+
+// One character per pixel, by brightness
+void printMatrix() {
+    static const char shades[] = " .:-=+*#%@";
+
+    for ( uint row = LED_MATRIX_ROWS; row-- > 0; ) {
+        for ( uint col = 0; col < LED_MATRIX_COLS; col++ ) {
+            printf("%c", shades[ ledMatrix.at(row, col).getLuma() * 9 / 255 ]);
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char **argv) {
+    bool raw = argc > 1 && strcmp(argv[1], "--raw") == 0;
+
+    DdpReceiver mapped_receiver(leds, NUM_LEDS, ledmap_matrix, LED_MATRIX_ROWS * LED_MATRIX_COLS, DDP_TIMEOUT_MS);
+    DdpReceiver raw_receiver(leds, NUM_LEDS, DDP_TIMEOUT_MS);
+    DdpReceiver &ddp = raw ? raw_receiver : mapped_receiver;
+
+    if ( !ddp.begin(DDP_PORT) ) {
+        fprintf(stderr, "Cannot listen on UDP port %u\n", DDP_PORT);
+        return 1;
+    }
+    printf("Listening on UDP port %u (%s mode)\n", DDP_PORT, raw ? "raw" : "matrix");
+
+    unsigned long last_print_ms = 0;
+    unsigned long first_frame_ms = 0;
+    unsigned long last_frame_ms = 0;
+    bool started = false;
+
+    while ( true ) {
+        unsigned long now = millis();
+
+        if ( ddp.poll(now) ) {
+            if ( !started ) {
+                started = true;
+                first_frame_ms = now;
+            }
+            last_frame_ms = now;
+
+            // Print at most 2 frames per second
+            if ( now - last_print_ms >= 500 ) {
+                last_print_ms = now;
+                printf("\nframe %u, packets %u, lost %u\n", ddp.getFrames(), ddp.getPackets(), ddp.getLostPackets());
+                printMatrix();
+            }
+        }
+
+        if ( started && !ddp.isActive() ) {
+            break;
+        }
+        delay(1);
+    }
+
+    unsigned long duration_ms = last_frame_ms - first_frame_ms;
+    printf("\nSender stopped: %u frames (%.1f fps), %u packets, %u lost, %u rejected, last frame hash %08x\n",
+        ddp.getFrames(), duration_ms ? (ddp.getFrames() - 1) * 1000.0 / duration_ms : 0.0, ddp.getPackets(),
+        ddp.getLostPackets(), ddp.getRejectedPackets(), FrameChangeDetector::hash(leds, NUM_LEDS));
+    return 0;
+}
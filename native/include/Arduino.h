@@ -0,0 +1,74 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Host stand-in for the parts of the Arduino core used by the animations
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <chrono>
+#include <thread>
+
+// Flash storage is ordinary memory on the host
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+inline unsigned long micros() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long millis() {
+    return micros() / 1000;
+}
+
+inline void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline void yield() {}
+
+template<typename T, typename L, typename H>
+T constrain(T value, L low, H high) {
+    return value < (T)low ? (T)low : (value > (T)high ? (T)high : value);
+}
+
+class HardwareSerial {
+public:
+    void begin(unsigned long) {}
+
+    template<typename T>
+    void print(const T &value) {
+        printValue(value);
+    }
+
+    template<typename T>
+    void println(const T &value) {
+        printValue(value);
+        fputc('\n', stdout);
+    }
+
+    void println() {
+        fputc('\n', stdout);
+    }
+
+    template<typename... Args>
+    void printf(const char *format, Args... args) {
+        ::printf(format, args...);
+    }
+
+private:
+    void printValue(const char *value) { fputs(value, stdout); }
+    void printValue(char value) { fputc(value, stdout); }
+    void printValue(int value) { ::printf("%d", value); }
+    void printValue(unsigned int value) { ::printf("%u", value); }
+    void printValue(long value) { ::printf("%ld", value); }
+    void printValue(unsigned long value) { ::printf("%lu", value); }
+};
+
+inline HardwareSerial Serial;
+
+#endif
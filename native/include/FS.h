@@ -0,0 +1,145 @@
+#ifndef NATIVE_FS_H
+#define NATIVE_FS_H
+
+// Host stand-in for the ESP8266 SPIFFS file system, backed by a directory.
+// The directory is "data" by default (same as the PlatformIO file system image), it can be changed with the
+// SPIFFS_DIR environment variable.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <dirent.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+namespace fs {
+
+class File {
+private:
+    std::shared_ptr<FILE> file;
+
+public:
+    File() {}
+    File(FILE *_file) {
+        if ( _file ) {
+            file.reset(_file, fclose);
+        }
+    }
+
+    operator bool() const {
+        return file != nullptr;
+    }
+
+    bool seek(uint32_t pos, SeekMode mode) {
+        return fseek(file.get(), pos, mode == SeekSet ? SEEK_SET : (mode == SeekCur ? SEEK_CUR : SEEK_END)) == 0;
+    }
+
+    size_t position() const {
+        return ftell(file.get());
+    }
+
+    size_t size() const {
+        long pos = ftell(file.get());
+        fseek(file.get(), 0, SEEK_END);
+        long end = ftell(file.get());
+        fseek(file.get(), pos, SEEK_SET);
+        return end;
+    }
+
+    int available() {
+        return size() - position();
+    }
+
+    size_t read(uint8_t *buf, size_t size) {
+        return fread(buf, 1, size, file.get());
+    }
+
+    size_t readBytes(char *buffer, size_t length) {
+        return fread(buffer, 1, length, file.get());
+    }
+
+    size_t write(const uint8_t *buf, size_t size) {
+        return fwrite(buf, 1, size, file.get());
+    }
+
+    void close() {
+        file.reset();
+    }
+};
+
+class Dir {
+private:
+    std::vector<std::string> names;
+    size_t index;
+
+public:
+    Dir(std::vector<std::string> _names) : names(_names), index(0) {}
+
+    bool next() {
+        if ( index < names.size() ) {
+            index++;
+            return true;
+        }
+        return false;
+    }
+
+    std::string fileName() const {
+        return names[index - 1];
+    }
+};
+
+class FS {
+private:
+    static std::string rootDir() {
+        const char *dir = getenv("SPIFFS_DIR");
+        return dir ? dir : "data";
+    }
+
+public:
+    bool begin() {
+        return true;
+    }
+
+    bool exists(const char *path) {
+        FILE *f = fopen((rootDir() + path).c_str(), "rb");
+        if ( f ) {
+            fclose(f);
+            return true;
+        }
+        return false;
+    }
+
+    File open(const char *path, const char *mode) {
+        std::string binary_mode = std::string(mode) + "b";
+        return File(fopen((rootDir() + path).c_str(), binary_mode.c_str()));
+    }
+
+    Dir openDir(const char *path) {
+        std::vector<std::string> names;
+        DIR *dir = opendir((rootDir() + path).c_str());
+        if ( dir ) {
+            while ( struct dirent *entry = readdir(dir) ) {
+                if ( entry->d_name[0] != '.' ) {
+                    names.push_back(std::string("/") + entry->d_name);
+                }
+            }
+            closedir(dir);
+        }
+        // SPIFFS lists the files in creation order, the directory order is not stable: sort by name instead
+        std::sort(names.begin(), names.end());
+        return Dir(names);
+    }
+};
+
+}
+
+inline fs::FS SPIFFS;
+
+#endif
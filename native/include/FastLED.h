@@ -0,0 +1,369 @@
+#ifndef NATIVE_FASTLED_H
+#define NATIVE_FASTLED_H
+
+// Host stand-in for the parts of FastLED used by the animations.
+// The color conversion, math and random functions follow the FastLED implementation so that the
+// native build renders the same pixels as the ESP8266 build.
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+typedef uint8_t fract8;
+
+inline uint8_t scale8(uint8_t i, fract8 scale) {
+    return ((uint16_t)i * (1 + (uint16_t)scale)) >> 8;
+}
+
+inline uint8_t scale8_video(uint8_t i, fract8 scale) {
+    return (((uint16_t)i * (uint16_t)scale) >> 8) + ((i && scale) ? 1 : 0);
+}
+
+inline uint8_t qadd8(uint8_t i, uint8_t j) {
+    unsigned int t = i + j;
+    return t > 255 ? 255 : t;
+}
+
+inline uint8_t qsub8(uint8_t i, uint8_t j) {
+    int t = i - j;
+    return t < 0 ? 0 : t;
+}
+
+inline uint8_t dim8_raw(uint8_t x) {
+    return scale8(x, x);
+}
+
+inline uint8_t triwave8(uint8_t in) {
+    if ( in & 0x80 ) {
+        in = 255 - in;
+    }
+    return in << 1;
+}
+
+// Same approximation as FastLED's sin8_C()
+inline uint8_t sin8(uint8_t theta) {
+    static const uint8_t b_m16_interleave[] = { 0, 49, 49, 41, 90, 27, 117, 10 };
+
+    uint8_t offset = theta;
+    if ( theta & 0x40 ) {
+        offset = 255 - offset;
+    }
+    offset &= 0x3F;
+
+    uint8_t secoffset = offset & 0x0F;
+    if ( theta & 0x40 ) {
+        secoffset++;
+    }
+
+    uint8_t section = offset >> 4;
+    uint8_t b = b_m16_interleave[section * 2];
+    uint8_t m16 = b_m16_interleave[section * 2 + 1];
+    uint8_t mx = (m16 * secoffset) >> 4;
+
+    int8_t y = mx + b;
+    if ( theta & 0x80 ) {
+        y = -y;
+    }
+    return y + 128;
+}
+
+// Random number generator
+inline uint16_t rand16seed = 1337;
+
+inline uint8_t random8() {
+    rand16seed = (rand16seed * 2053) + 13849;
+    return (uint8_t)(((uint8_t)(rand16seed & 0xFF)) + ((uint8_t)(rand16seed >> 8)));
+}
+
+inline uint8_t random8(uint8_t lim) {
+    return (random8() * lim) >> 8;
+}
+
+inline uint8_t random8(uint8_t min, uint8_t lim) {
+    return random8(lim - min) + min;
+}
+
+inline uint16_t random16() {
+    rand16seed = (rand16seed * 2053) + 13849;
+    return rand16seed;
+}
+
+inline uint16_t random16(uint16_t lim) {
+    return ((uint32_t)random16() * lim) >> 16;
+}
+
+inline void random16_set_seed(uint16_t seed) {
+    rand16seed = seed;
+}
+
+inline uint16_t random16_get_seed() {
+    return rand16seed;
+}
+
+struct CHSV {
+    union {
+        struct {
+            union { uint8_t hue; uint8_t h; };
+            union { uint8_t saturation; uint8_t sat; uint8_t s; };
+            union { uint8_t value; uint8_t val; uint8_t v; };
+        };
+        uint8_t raw[3];
+    };
+
+    CHSV() : h(0), s(0), v(0) {}
+    CHSV(uint8_t ih, uint8_t is, uint8_t iv) : h(ih), s(is), v(iv) {}
+};
+
+struct CRGB;
+void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb);
+
+struct CRGB {
+    union {
+        struct {
+            union { uint8_t r; uint8_t red; };
+            union { uint8_t g; uint8_t green; };
+            union { uint8_t b; uint8_t blue; };
+        };
+        uint8_t raw[3];
+    };
+
+    typedef enum {
+        Black = 0x000000,
+        Blue = 0x0000FF,
+        Green = 0x008000,
+        Red = 0xFF0000,
+        White = 0xFFFFFF
+    } HTMLColorCode;
+
+    CRGB() {}
+    CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+    CRGB(uint32_t colorcode) : r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b(colorcode & 0xFF) {}
+    CRGB(HTMLColorCode colorcode) : CRGB((uint32_t)colorcode) {}
+    CRGB(const CHSV &rhs) {
+        hsv2rgb_rainbow(rhs, *this);
+    }
+
+    CRGB &operator=(const CHSV &rhs) {
+        hsv2rgb_rainbow(rhs, *this);
+        return *this;
+    }
+
+    CRGB &operator=(uint32_t colorcode) {
+        r = (colorcode >> 16) & 0xFF;
+        g = (colorcode >> 8) & 0xFF;
+        b = colorcode & 0xFF;
+        return *this;
+    }
+
+    CRGB &operator+=(const CRGB &rhs) {
+        r = qadd8(r, rhs.r);
+        g = qadd8(g, rhs.g);
+        b = qadd8(b, rhs.b);
+        return *this;
+    }
+
+    CRGB &nscale8(uint8_t scaledown) {
+        r = scale8(r, scaledown);
+        g = scale8(g, scaledown);
+        b = scale8(b, scaledown);
+        return *this;
+    }
+
+    CRGB &nscale8_video(uint8_t scaledown) {
+        r = scale8_video(r, scaledown);
+        g = scale8_video(g, scaledown);
+        b = scale8_video(b, scaledown);
+        return *this;
+    }
+
+    uint8_t &operator[](uint8_t x) {
+        return raw[x];
+    }
+
+    const uint8_t &operator[](uint8_t x) const {
+        return raw[x];
+    }
+
+    uint8_t getLuma() const {
+        return scale8(r, 54) + scale8(g, 183) + scale8(b, 18);
+    }
+};
+
+inline bool operator==(const CRGB &lhs, const CRGB &rhs) {
+    return lhs.r == rhs.r && lhs.g == rhs.g && lhs.b == rhs.b;
+}
+
+inline bool operator!=(const CRGB &lhs, const CRGB &rhs) {
+    return !(lhs == rhs);
+}
+
+inline void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb) {
+    uint8_t hue = hsv.hue;
+    uint8_t sat = hsv.sat;
+    uint8_t val = hsv.val;
+
+    uint8_t offset = hue & 0x1F;
+    uint8_t offset8 = offset << 3;
+    uint8_t third = scale8(offset8, (256 / 3));
+
+    uint8_t r, g, b;
+
+    if ( !(hue & 0x80) ) {
+        if ( !(hue & 0x40) ) {
+            if ( !(hue & 0x20) ) {
+                r = 255 - third; g = third; b = 0;
+            }
+            else {
+                r = 171; g = 85 + third; b = 0;
+            }
+        }
+        else {
+            if ( !(hue & 0x20) ) {
+                uint8_t twothirds = scale8(offset8, ((256 * 2) / 3));
+                r = 171 - twothirds; g = 170 + third; b = 0;
+            }
+            else {
+                r = 0; g = 255 - third; b = third;
+            }
+        }
+    }
+    else {
+        if ( !(hue & 0x40) ) {
+            if ( !(hue & 0x20) ) {
+                uint8_t twothirds = scale8(offset8, ((256 * 2) / 3));
+                r = 0; g = 171 - twothirds; b = 85 + twothirds;
+            }
+            else {
+                r = third; g = 0; b = 255 - third;
+            }
+        }
+        else {
+            if ( !(hue & 0x20) ) {
+                r = 85 + third; g = 0; b = 171 - third;
+            }
+            else {
+                r = 170 + third; g = 0; b = 85 - third;
+            }
+        }
+    }
+
+    if ( sat != 255 ) {
+        if ( sat == 0 ) {
+            r = 255; g = 255; b = 255;
+        }
+        else {
+            uint8_t desat = 255 - sat;
+            desat = scale8_video(desat, desat);
+            uint8_t satscale = 255 - desat;
+            if ( r ) r = scale8(r, satscale);
+            if ( g ) g = scale8(g, satscale);
+            if ( b ) b = scale8(b, satscale);
+            r += desat;
+            g += desat;
+            b += desat;
+        }
+    }
+
+    if ( val != 255 ) {
+        val = scale8_video(val, val);
+        if ( val == 0 ) {
+            r = 0; g = 0; b = 0;
+        }
+        else {
+            if ( r ) r = scale8(r, val);
+            if ( g ) g = scale8(g, val);
+            if ( b ) b = scale8(b, val);
+        }
+    }
+
+    rgb.r = r;
+    rgb.g = g;
+    rgb.b = b;
+}
+
+inline void hsv2rgb_rainbow(const CHSV *phsv, CRGB *prgb, int numLeds) {
+    for ( int i = 0; i < numLeds; i++ ) {
+        hsv2rgb_rainbow(phsv[i], prgb[i]);
+    }
+}
+
+inline void fill_solid(CRGB *leds, int numToFill, const CRGB &color) {
+    for ( int i = 0; i < numToFill; i++ ) {
+        leds[i] = color;
+    }
+}
+
+typedef enum { NOBLEND = 0, LINEARBLEND = 1 } TBlendType;
+
+class CHSVPalette16 {
+public:
+    CHSV entries[16];
+
+    CHSVPalette16() {}
+    CHSVPalette16(const CHSV &c00, const CHSV &c01, const CHSV &c02, const CHSV &c03,
+                  const CHSV &c04, const CHSV &c05, const CHSV &c06, const CHSV &c07,
+                  const CHSV &c08, const CHSV &c09, const CHSV &c10, const CHSV &c11,
+                  const CHSV &c12, const CHSV &c13, const CHSV &c14, const CHSV &c15) {
+        const CHSV *colors[16] = { &c00, &c01, &c02, &c03, &c04, &c05, &c06, &c07,
+                                   &c08, &c09, &c10, &c11, &c12, &c13, &c14, &c15 };
+        for ( int i = 0; i < 16; i++ ) {
+            entries[i] = *colors[i];
+        }
+    }
+
+    const CHSV &operator[](uint8_t x) const {
+        return entries[x];
+    }
+};
+
+inline CHSV ColorFromPalette(const CHSVPalette16 &pal, uint8_t index, uint8_t brightness = 255, TBlendType blendType = LINEARBLEND) {
+    uint8_t hi4 = index >> 4;
+    uint8_t lo4 = index & 0x0F;
+
+    const CHSV *entry = &pal[0] + hi4;
+    uint8_t hue1 = entry->hue;
+    uint8_t sat1 = entry->sat;
+    uint8_t val1 = entry->val;
+
+    if ( lo4 && blendType != NOBLEND ) {
+        entry = (hi4 == 15) ? &pal[0] : entry + 1;
+
+        uint8_t f2 = lo4 << 4;
+        uint8_t f1 = 255 - f2;
+
+        uint8_t hue2 = entry->hue;
+        uint8_t sat2 = entry->sat;
+        uint8_t val2 = entry->val;
+
+        if ( sat1 == 0 || val1 == 0 ) {
+            hue1 = hue2;
+        }
+        if ( sat2 == 0 || val2 == 0 ) {
+            hue2 = hue1;
+        }
+
+        sat1 = scale8(sat1, f1);
+        val1 = scale8(val1, f1);
+        sat2 = scale8(sat2, f2);
+        val2 = scale8(val2, f2);
+
+        sat1 += sat2;
+        val1 += val2;
+
+        uint8_t deltaHue = (uint8_t)(hue2 - hue1);
+        if ( deltaHue & 0x80 ) {
+            hue1 -= scale8(256 - deltaHue, f2);
+        }
+        else {
+            hue1 += scale8(deltaHue, f2);
+        }
+    }
+
+    if ( brightness != 255 ) {
+        val1 = scale8_video(val1, brightness);
+    }
+
+    return CHSV(hue1, sat1, val1);
+}
+
+#endif
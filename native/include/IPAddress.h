@@ -0,0 +1,37 @@
+#ifndef NATIVE_IPADDRESS_H
+#define NATIVE_IPADDRESS_H
+
+// Host stand-in for the Arduino IPAddress class (IPv4 only)
+
+#include <Arduino.h>
+#include <arpa/inet.h>
+
+class IPAddress {
+private:
+    uint32_t address; // Network byte order, as on the ESP8266
+
+public:
+    IPAddress() : address(0) {}
+
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+        uint8_t bytes[4] = { a, b, c, d };
+        memcpy(&address, bytes, 4);
+    }
+
+    IPAddress(uint32_t _address) : address(_address) {}
+
+    bool fromString(const char *text) {
+        in_addr parsed;
+        if ( inet_pton(AF_INET, text, &parsed) != 1 ) {
+            return false;
+        }
+        address = parsed.s_addr;
+        return true;
+    }
+
+    operator uint32_t() const {
+        return address;
+    }
+};
+
+#endif
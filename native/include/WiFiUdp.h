@@ -0,0 +1,144 @@
+#ifndef NATIVE_WIFIUDP_H
+#define NATIVE_WIFIUDP_H
+
+// Host stand-in for the ESP8266 WiFiUDP class, on top of a non-blocking POSIX socket.
+// As on the ESP8266, parsePacket() takes the next datagram and read() returns its bytes.
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+class WiFiUDP {
+private:
+    int fd = -1;
+    uint8_t packet[1500];
+    size_t packet_size = 0;
+    size_t position = 0;
+
+    uint8_t out_packet[1500];
+    size_t out_size = 0;
+    sockaddr_in destination = {};
+
+public:
+    ~WiFiUDP() {
+        stop();
+    }
+
+    // Returns 1 on success, 0 if the port cannot be bound
+    uint8_t begin(uint16_t port) {
+        stop();
+
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if ( fd < 0 ) {
+            return 0;
+        }
+
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+        if ( bind(fd, (const sockaddr *)&address, sizeof(address)) < 0 ) {
+            stop();
+            return 0;
+        }
+        return 1;
+    }
+
+    // Receive the datagrams sent to a multicast group, interface_address 0 for any interface
+    uint8_t beginMulticast(IPAddress interface_address, IPAddress multicast, uint16_t port) {
+        if ( !begin(port) ) {
+            return 0;
+        }
+
+        ip_mreq request = {};
+        request.imr_multiaddr.s_addr = (uint32_t)multicast;
+        request.imr_interface.s_addr = (uint32_t)interface_address;
+        if ( setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) < 0 ) {
+            stop();
+            return 0;
+        }
+        return 1;
+    }
+
+    int beginPacketMulticast(IPAddress multicast, uint16_t port, IPAddress interface_address, int ttl = 1) {
+        if ( fd < 0 ) {
+            fd = socket(AF_INET, SOCK_DGRAM, 0);
+        }
+        unsigned char loop = 1;
+        unsigned char hops = ttl;
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof(hops));
+        if ( (uint32_t)interface_address != 0 ) {
+            in_addr source = {};
+            source.s_addr = (uint32_t)interface_address;
+            setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &source, sizeof(source));
+        }
+
+        destination.sin_family = AF_INET;
+        destination.sin_addr.s_addr = (uint32_t)multicast;
+        destination.sin_port = htons(port);
+        out_size = 0;
+        return 1;
+    }
+
+    size_t write(const uint8_t *buffer, size_t len) {
+        size_t count = len < sizeof(out_packet) - out_size ? len : sizeof(out_packet) - out_size;
+        memcpy(out_packet + out_size, buffer, count);
+        out_size += count;
+        return count;
+    }
+
+    int endPacket() {
+        ssize_t sent = sendto(fd, out_packet, out_size, 0, (const sockaddr *)&destination, sizeof(destination));
+        out_size = 0;
+        return sent >= 0 ? 1 : 0;
+    }
+
+    void stop() {
+        if ( fd >= 0 ) {
+            close(fd);
+            fd = -1;
+        }
+        packet_size = position = 0;
+    }
+
+    // Size of the next datagram, 0 if none is waiting
+    int parsePacket() {
+        packet_size = position = 0;
+        if ( fd < 0 ) {
+            return 0;
+        }
+
+        ssize_t size = recv(fd, packet, sizeof(packet), 0);
+        if ( size <= 0 ) {
+            return 0;
+        }
+        packet_size = size;
+        return size;
+    }
+
+    int available() {
+        return packet_size - position;
+    }
+
+    int read() {
+        return position < packet_size ? packet[position++] : -1;
+    }
+
+    int read(uint8_t *buffer, size_t len) {
+        size_t count = len < packet_size - position ? len : packet_size - position;
+        memcpy(buffer, packet + position, count);
+        position += count;
+        return count;
+    }
+};
+
+#endif
@@ -0,0 +1,220 @@
+// Frame recorder and diff tool: records the frames of an animation with a fixed random seed, and compares two
+// recordings, e.g. before and after an optimisation of an animation (the pixels must not change).
+// Build from the project folder (SPIFFS is read from the "data" folder), then:
+//   .pio/build/native_record/program record <animation> <frames> <file> [--matrix]
+//   .pio/build/native_record/program diff <file> <file>
+//   .pio/build/native_record/program info <file>
+//   .pio/build/native_record/program check [folder]
+//   .pio/build/native_record/program golden [folder]
+// The frames are the LEDs in the order of the strip (outdoor ledmap), or the matrix row by row with --matrix.
+//
+// Golden recordings of the deterministic animations are kept in native/golden (matrix order, config.hpp.EXAMPLE and
+// the pictures of the "data" folder): "check" records them again and compares, the exit status is 1 if any frame
+// differs. "golden" records them again, when a change of the pixels is intended.
+
+#include <Arduino.h>
+#include "config.hpp"
+
+#include <FS.h>
+#include <FastLED.h>
+#include <string>
+#include <vector>
+
+#include "AnimationRegistry.hpp"
+#include "Arena.hpp"
+#include "FrameBuffer.hpp"
+#include "FrameRecorder.hpp"
+#include "RunningDots.hpp"
+#include "ScrollingPicture.hpp"
+#include "GreenChristmas.hpp"
+#include "PlasmaWaves.hpp"
+#include "MoviePlayer.hpp"
+#include "ShaderAnimation.hpp"
+
+#include "ledmap.hpp"
+
+typedef AnimationRegistry<RunningDots, ScrollingPicture, GreenChristmas, PlasmaWaves, MoviePlayer, ShaderAnimation> Animations;
+
+static const uint16_t RECORD_SEED = 1337;
+static const uint MATRIX_LEDS = LED_MATRIX_ROWS * LED_MATRIX_COLS;
+
+// Animations of the golden recordings (their frames only depend on the seed), and their length
+static const char *const GOLDEN_ANIMATIONS[] = { "dots", "christmas", "plasma", "picture" };
+static const uint GOLDEN_FRAMES = 48;
+static const char *const GOLDEN_FOLDER = "native/golden";
+
+CRGB leds[NUM_LEDS];
+FrameBuffer ledMatrix(leds, ledmap_matrix, LED_MATRIX_ROWS, LED_MATRIX_COLS, ledgeometry.points, NUM_LEDS);
+StaticArena<Animations::arenaSize(LED_MATRIX_ROWS, LED_MATRIX_COLS) + FrameRecorder::arenaSize(NUM_LEDS)> arena;
+
+int record(const char *name, uint frames, const char *path, bool matrix_order) {
+    random16_set_seed(RECORD_SEED);
+    arena.reset();
+    fill_solid(leds, NUM_LEDS, CRGB::Black);
+    Animations animations(ledMatrix, arena);
+    if ( !animations.selectByName(name) ) {
+        fprintf(stderr, "Unknown animation %s\n", name);
+        return 2;
+    }
+    animations.forEach([](auto &animation) { animation.nextImage(); });
+
+    fs::File file(fopen(path, "wb"));
+    if ( !file ) {
+        fprintf(stderr, "Cannot create %s\n", path);
+        return 2;
+    }
+
+    uint count = matrix_order ? MATRIX_LEDS : NUM_LEDS;
+    FrameRecorder recorder(arena, count);
+    std::vector<CRGB> matrix(MATRIX_LEDS);
+    recorder.begin(file, matrix_order ? LED_MATRIX_COLS : 0);
+
+    for ( uint frame = 0; frame < frames; frame++ ) {
+        animations.nextFrame();
+
+        if ( matrix_order ) {
+            for ( uint row = 0; row < LED_MATRIX_ROWS; row++ ) {
+                for ( uint col = 0; col < LED_MATRIX_COLS; col++ ) {
+                    matrix[row * LED_MATRIX_COLS + col] = ledMatrix.at(row, col);
+                }
+            }
+            recorder.record(file, matrix.data());
+        }
+        else {
+            recorder.record(file, leds);
+        }
+    }
+
+    printf("%s: %u frames of %u LEDs, %u bytes (%.1f bytes per frame, %.1f%% of the raw frames)\n", path,
+        recorder.getFrames(), count, (uint)recorder.getBytes(), (double)recorder.getBytes() / frames,
+        100.0 * recorder.getBytes() / ((double)frames * count * 3));
+    return 0;
+}
+
+bool openStream(const char *path, fs::File &file, FrameReplayer &replayer) {
+    file = fs::File(fopen(path, "rb"));
+    if ( !file || !replayer.begin(file) ) {
+        fprintf(stderr, "%s is not a frame recording\n", path);
+        return false;
+    }
+    return true;
+}
+
+// Prints the first divergent frame and LED. Returns 0 if the recordings are identical, 1 if not.
+int diff(const char *path_a, const char *path_b) {
+    std::vector<CRGB> leds_a(65535);
+    std::vector<CRGB> leds_b(65535);
+    FrameReplayer a(leds_a.data(), leds_a.size());
+    FrameReplayer b(leds_b.data(), leds_b.size());
+    fs::File file_a;
+    fs::File file_b;
+
+    if ( !openStream(path_a, file_a, a) || !openStream(path_b, file_b, b) ) {
+        return 2;
+    }
+    if ( a.getCount() != b.getCount() || a.getCols() != b.getCols() ) {
+        printf("Different frame sizes: %u and %u LEDs\n", a.getCount(), b.getCount());
+        return 1;
+    }
+
+    uint32_t different_frames = 0;
+    while ( true ) {
+        bool more_a = a.next(file_a);
+        bool more_b = b.next(file_b);
+        if ( more_a != more_b ) {
+            printf("Different lengths: %s ends after %u frames\n", more_a ? path_b : path_a, more_a ? b.getFrame() : a.getFrame());
+            return 1;
+        }
+        if ( !more_a ) {
+            break;
+        }
+
+        for ( uint i = 0; i < a.getCount(); i++ ) {
+            if ( leds_a[i] == leds_b[i] ) {
+                continue;
+            }
+
+            if ( different_frames == 0 ) {
+                printf("First difference: frame %u, LED %u", a.getFrame() - 1, i);
+                if ( a.getCols() ) {
+                    printf(" (row %u, col %u)", i / a.getCols(), i % a.getCols());
+                }
+                printf(": %u,%u,%u != %u,%u,%u\n", leds_a[i].r, leds_a[i].g, leds_a[i].b, leds_b[i].r, leds_b[i].g, leds_b[i].b);
+            }
+            different_frames++;
+            break;
+        }
+    }
+
+    if ( different_frames ) {
+        printf("%u of %u frames differ\n", different_frames, a.getFrame());
+        return 1;
+    }
+    printf("%u frames identical\n", a.getFrame());
+    return 0;
+}
+
+int info(const char *path) {
+    std::vector<CRGB> leds(65535);
+    FrameReplayer replayer(leds.data(), leds.size());
+    fs::File file;
+    if ( !openStream(path, file, replayer) ) {
+        return 2;
+    }
+
+    while ( replayer.next(file) ) {}
+    printf("%s: %u frames of %u LEDs (%s order), %u bytes\n", path, replayer.getFrame(), replayer.getCount(),
+        replayer.getCols() ? "matrix" : "strip", (uint)file.size());
+    return 0;
+}
+
+// Records the golden animations into folder, or into temporary files compared with the recordings of folder.
+// Returns 0 if all the recordings are identical, 1 if not.
+int golden(const char *folder, bool compare) {
+    uint failures = 0;
+    for ( const char *name : GOLDEN_ANIMATIONS ) {
+        std::string path = std::string(folder) + "/" + name + ".lfr";
+        std::string new_path = compare ? path + ".new" : path;
+        if ( record(name, GOLDEN_FRAMES, new_path.c_str(), true) != 0 ) {
+            return 2;
+        }
+
+        if ( compare ) {
+            printf("%s: ", name);
+            if ( diff(path.c_str(), new_path.c_str()) == 0 ) {
+                remove(new_path.c_str());
+            }
+            else {
+                // Kept for the diff tool
+                failures++;
+            }
+        }
+    }
+
+    if ( failures ) {
+        printf("%u of %u golden recordings differ\n", failures, (uint)(sizeof(GOLDEN_ANIMATIONS) / sizeof(GOLDEN_ANIMATIONS[0])));
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if ( argc >= 5 && strcmp(argv[1], "record") == 0 ) {
+        return record(argv[2], atoi(argv[3]), argv[4], argc > 5 && strcmp(argv[5], "--matrix") == 0);
+    }
+    if ( argc == 4 && strcmp(argv[1], "diff") == 0 ) {
+        return diff(argv[2], argv[3]);
+    }
+    if ( argc == 3 && strcmp(argv[1], "info") == 0 ) {
+        return info(argv[2]);
+    }
+    if ( (argc == 2 || argc == 3) && (strcmp(argv[1], "check") == 0 || strcmp(argv[1], "golden") == 0) ) {
+        return golden(argc == 3 ? argv[2] : GOLDEN_FOLDER, strcmp(argv[1], "check") == 0);
+    }
+
+    fprintf(stderr, "Usage: %s record <animation> <frames> <file> [--matrix]\n"
+        "       %s diff <file> <file>\n"
+        "       %s info <file>\n"
+        "       %s check|golden [folder]\n", argv[0], argv[0], argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,85 @@
+// Shader compiler: compiles a shader (see include/ShaderCompiler.hpp) on the host and prints its bytecode in
+// hexadecimal, to be sent on MQTT_SHADER_TOPIC, and the instructions.
+// Build and run from the project folder:
+//   pio run -e native_shader && .pio/build/native_shader/program "h = x / 16 + t / 4; v = tri(x / 8 - t)"
+//   mosquitto_pub -t <root topic>/shader -m <bytecode>
+// The source can also be read from a file: program -f fire.shader
+
+#include <Arduino.h>
+#include "config.hpp"
+
+#include <string>
+
+#include "ShaderAnimation.hpp"
+#include "ShaderCompiler.hpp"
+#include "ShaderVM.hpp"
+
+static const char *const OPCODE_NAMES[SHADER_OPCODES] = {
+    "ldi", "mov", "add", "sub", "mul", "div", "mod", "min", "max", "lt", "sel", "abs", "sin", "cos", "tri", "frac"
+};
+
+static const char *const REGISTER_NAMES[SHADER_FIRST_TEMP] = { "x", "y", "t", "i", "hue", "out0", "out1", "out2" };
+
+void printRegister(uint8_t reg) {
+    if ( reg < SHADER_FIRST_TEMP ) {
+        printf(" %s", REGISTER_NAMES[reg]);
+    }
+    else {
+        printf(" r%u", reg);
+    }
+}
+
+int main(int argc, char **argv) {
+    std::string source;
+    if ( argc == 3 && strcmp(argv[1], "-f") == 0 ) {
+        FILE *file = fopen(argv[2], "r");
+        if ( !file ) {
+            fprintf(stderr, "Cannot open %s\n", argv[2]);
+            return 2;
+        }
+        int c;
+        while ( (c = fgetc(file)) != EOF ) {
+            source += (char)c;
+        }
+        fclose(file);
+    }
+    else if ( argc == 2 ) {
+        source = argv[1];
+    }
+    else {
+        fprintf(stderr, "Usage: %s <source> | -f <file>\n", argv[0]);
+        return 2;
+    }
+
+    ShaderProgram program;
+    ShaderCompiler compiler(program);
+    if ( !compiler.compile(source.c_str()) ) {
+        fprintf(stderr, "Error at %u: %s\n", compiler.getErrorPosition(), compiler.getError());
+        return 1;
+    }
+
+    for ( uint pc = 0; pc < program.length; pc++ ) {
+        const ShaderInstruction &instruction = program.code[pc];
+        printf("%3u  %-4s", pc, OPCODE_NAMES[instruction.op]);
+        printRegister(instruction.d);
+        if ( instruction.op == SHADER_LDI ) {
+            printf(" %.4f\n", (int16_t)(instruction.a | (instruction.b << 8)) / 256.0);
+            continue;
+        }
+        printRegister(instruction.a);
+        if ( instruction.op >= SHADER_ADD && instruction.op <= SHADER_SEL ) {
+            printRegister(instruction.b);
+        }
+        printf("\n");
+    }
+
+    uint8_t bytecode[SHADER_HEADER_SIZE + SHADER_MAX_INSTRUCTIONS * sizeof(ShaderInstruction)];
+    size_t size = program.toBytecode(bytecode, sizeof(bytecode));
+    printf("\n%s mode, %u instructions, %u per frame on %u LEDs (budget %u)\n", program.mode == SHADER_RGB ? "RGB" : "HSV",
+        program.length, program.length * NUM_LEDS, NUM_LEDS, SHADER_MAX_INSTRUCTIONS_PER_FRAME);
+    for ( size_t i = 0; i < size; i++ ) {
+        printf("%02x", bytecode[i]);
+    }
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,84 @@
+// Host test of the frame synchronization: runs an animation as a leader or a follower node on the multicast group of
+// config.hpp, and prints the hash of the frame once per second of the shared timeline. Nodes that are synchronized
+// print the same hashes for the same frame numbers.
+// Build and run from the project folder, in several terminals (SPIFFS is read from the "data" folder):
+//   pio run -e native_sync && .pio/build/native_sync/program leader|follower [animation] [seconds]
+
+#include <Arduino.h>
+#include "config.hpp"
+
+#include <FastLED.h>
+
+#include "AnimationRegistry.hpp"
+#include "Arena.hpp"
+#include "FrameBuffer.hpp"
+#include "FrameChangeDetector.hpp"
+#include "FrameScheduler.hpp"
+#include "FrameSync.hpp"
+#include "RunningDots.hpp"
+#include "ScrollingPicture.hpp"
+#include "GreenChristmas.hpp"
+#include "PlasmaWaves.hpp"
+#include "MoviePlayer.hpp"
+#include "ShaderAnimation.hpp"
+
+#include "ledmap.hpp"
+
+typedef AnimationRegistry<RunningDots, ScrollingPicture, GreenChristmas, PlasmaWaves, MoviePlayer, ShaderAnimation> Animations;
+
+CRGB leds[NUM_LEDS];
+FrameBuffer ledMatrix(leds, ledmap_matrix, LED_MATRIX_ROWS, LED_MATRIX_COLS, ledgeometry.points, NUM_LEDS);
+StaticArena<Animations::arenaSize(LED_MATRIX_ROWS, LED_MATRIX_COLS)> arena;
+
+int main(int argc, char **argv) {
+    if ( argc < 2 || (strcmp(argv[1], "leader") != 0 && strcmp(argv[1], "follower") != 0) ) {
+        fprintf(stderr, "Usage: %s leader|follower [animation] [seconds]\n", argv[0]);
+        return 1;
+    }
+    SyncMode mode = strcmp(argv[1], "leader") == 0 ? SYNC_LEADER : SYNC_FOLLOWER;
+    const char *name = argc > 2 ? argv[2] : "dots";
+    unsigned long duration_ms = argc > 3 ? atoi(argv[3]) * 1000UL : 10000;
+
+    Animations animations(ledMatrix, arena);
+    if ( !animations.selectByName(name) ) {
+        fprintf(stderr, "Unknown animation %s\n", name);
+        return 1;
+    }
+    animations.forEach([](auto &animation) { animation.nextImage(); });
+
+    FrameSync frameSync(mode, SYNC_INTERVAL_MS);
+    if ( !frameSync.begin(IPAddress(127, 0, 0, 1), SYNC_MULTICAST_ADDRESS, SYNC_PORT) ) {
+        fprintf(stderr, "Cannot join the multicast group %s on port %u\n", SYNC_MULTICAST_ADDRESS, SYNC_PORT);
+        return 1;
+    }
+
+    FrameScheduler scheduler(animations.getFramerate());
+    uint32_t printed_frame = 0;
+    bool was_synchronized = false;
+    unsigned long start_ms = millis();
+
+    while ( millis() - start_ms < duration_ms ) {
+        frameSync.poll(micros(), millis());
+
+        if ( frameSync.isSynchronized() != was_synchronized ) {
+            was_synchronized = frameSync.isSynchronized();
+            printf("%s, offset %lld us\n", was_synchronized ? "Synchronized" : "Lost the leader",
+                (long long)frameSync.getOffset());
+        }
+
+        uint steps = scheduler.stepsDue(micros());
+        if ( steps > 0 ) {
+            scheduler.setFramerate(animations.getFramerate());
+            frameSync.advance(animations, scheduler, steps);
+
+            uint32_t frame = frameSync.getFrame();
+            if ( frameSync.isSynchronized() && frame % animations.getFramerate() == 0 && frame != printed_frame ) {
+                printed_frame = frame;
+                printf("frame %u hash %08x\n", frame, FrameChangeDetector::hash(leds, NUM_LEDS));
+                fflush(stdout);
+            }
+        }
+        delay(1);
+    }
+    return 0;
+}
@@ -7,15 +7,36 @@
 #include <ArduinoOTA.h>
 #include <RemoteDebug.h>
 #include <FastLED.h>
-#include <vector>
+#include <type_traits>
 
 #include "rgbhsv.hpp"
 
+#include "Compositor.hpp"
+#include "FrameBuffer.hpp"
+#include "FrameChangeDetector.hpp"
+#include "FrameProfiler.hpp"
+#include "FrameScheduler.hpp"
+#include "FrameSync.hpp"
+#include "Metrics.hpp"
+#include "MqttCommands.hpp"
+#include "PowerLimiter.hpp"
+#include "SpscQueue.hpp"
+#include "AnimationRegistry.hpp"
+#include "Arena.hpp"
+#include "DdpReceiver.hpp"
 #include "RunningDots.hpp"
 #include "ScrollingPicture.hpp"
+#include "GreenChristmas.hpp"
+#include "PlasmaWaves.hpp"
+#include "MoviePlayer.hpp"
+#include "ShaderAnimation.hpp"
 
 #include "ledmap.hpp"
 
+#if LED_OUTPUT_UART1
+#include "Ws2812Uart1.hpp"
+#endif
+
 RemoteDebug Debug;
 
 WiFiClient wifiClient;
@@ -23,20 +44,148 @@ PubSubClient mqtt(wifiClient);
 
 CRGB leds[NUM_LEDS];
 
-std::vector< std::vector<CRGB> > ledMatrix(LED_MATRIX_ROWS, std::vector<CRGB>(LED_MATRIX_COLS, CRGB::Black) );
+#if LED_OUTPUT_UART1
+// The frames are sent in the background, see showLeds()
+Ws2812Uart1<NUM_LEDS> ledOutput(COLOR_ORDER);
+#endif
+
+// The animations render straight into leds[] through the ledmap, or from the position of each LED
+FrameBuffer ledMatrix(leds, ledmap_matrix, LED_MATRIX_ROWS, LED_MATRIX_COLS, ledgeometry.points, NUM_LEDS);
+
+// Buffers of the animations, reserved once at startup so that they never fragment the heap
+StaticArena<AnimationRegistry<ANIMATIONS>::arenaSize(LED_MATRIX_ROWS, LED_MATRIX_COLS)> arena;
+
+// The available animations are listed in config.hpp
+AnimationRegistry<ANIMATIONS> animations(ledMatrix, arena);
 
-#define N_ANIMATIONS 2 // Number of available animations
-RunningDots runningDots(ledMatrix, 5, 2);
-ScrollingPicture scrollingPicture(ledMatrix);
+// Overlays blended over the animations (sparkles, crossfade when the animation changes, fade out when the power is
+// switched off), into output_leds when at least one of them is visible
+CRGB output_leds[NUM_LEDS];
+CRGB crossfade_leds[NUM_LEDS];
+Compositor<SparkleLayer, CrossfadeLayer, FadeLayer> compositor(leds, output_leds, NUM_LEDS, SparkleLayer(ledmap_matrix_inverse),
+    CrossfadeLayer(crossfade_leds, NUM_LEDS), FadeLayer());
+
+// LEDs sent by the last showLeds(): leds or output_leds
+const CRGB *shown_leds = leds;
 
 bool power_is_on = true;
-bool change_image_request = false;
-bool change_animation_request = false;
-int current_animation = 0;
-int framerate = DEFAULT_FRAMES_PER_SECOND;
-RgbColor requested_color;
 
-void mqttconnect() {
+// Topics subscribed to, the MQTT callback parses the messages into commands executed by the frame loop
+const MqttTopic command_topics[] = {
+    { MQTT_COLOR_TOPIC, COMMAND_COLOR },
+    { MQTT_POWER_TOPIC, COMMAND_POWER },
+    { MQTT_BRIGHTNESS_TOPIC, COMMAND_BRIGHTNESS },
+    { MQTT_FPS_TOPIC, COMMAND_FPS },
+    { MQTT_ANIMATION_TOPIC, COMMAND_ANIMATION },
+    { MQTT_IMAGE_TOPIC, COMMAND_IMAGE },
+    { MQTT_SHADER_TOPIC, COMMAND_SHADER },
+};
+const MqttCommandParser commandParser(command_topics, sizeof(command_topics) / sizeof(command_topics[0]));
+SpscQueue<Command, 8> commands;
+
+// Payload of the last COMMAND_SHADER (source or bytecode in hexadecimal), too long for the commands
+char shader_payload[SHADER_MAX_HEX_SIZE];
+size_t shader_payload_length = 0;
+
+// Stages of loop() measured by the profiler
+enum LoopStage { STAGE_OTA, STAGE_DEBUG, STAGE_MQTT, STAGE_REQUESTS, STAGE_ANIMATION, STAGE_COMPOSE, STAGE_SHOW, N_STAGES };
+const char *const stage_names[N_STAGES] = { "ota", "debug", "mqtt", "requests", "animation", "compose", "show" };
+FrameProfiler<N_STAGES> profiler(stage_names);
+unsigned long lastStatsPublishMillis = 0;
+
+FrameScheduler scheduler(DEFAULT_FRAMES_PER_SECOND);
+uint32_t droppedFramesReported = 0;
+
+// Counters and gauges published on MQTT_METRICS_TOPIC, the durations are in microseconds and the peaks are the
+// highest values since the previous publication
+enum MetricsCounter { COUNTER_FRAMES, COUNTER_SHOWN, COUNTER_DROPPED, COUNTER_OVERRUNS, COUNTER_MQTT_RECONNECTS, N_COUNTERS };
+const char *const counter_names[N_COUNTERS] = { "frames", "shown", "dropped", "overruns", "mqtt_reconnects" };
+enum MetricsGauge { GAUGE_SHOW_US, GAUGE_LOOP_US, GAUGE_RSSI, GAUGE_FREE_HEAP, GAUGE_UPTIME, N_GAUGES };
+const char *const gauge_names[N_GAUGES] = { "show_us", "loop_us", "rssi", "free_heap", "uptime" };
+Metrics<N_COUNTERS, N_GAUGES> metrics(counter_names, gauge_names);
+unsigned long lastMetricsPublishMillis = 0;
+bool mqttConnectedOnce = false;
+
+// Identical frames are not sent to the LEDs
+FrameChangeDetector frameChangeDetector;
+
+// Brightness requested on MQTT, lowered by the power limiter when the frame would draw too much current
+uint8_t brightness = DEFAULT_BRIGHTNESS;
+PowerLimiter<(NUM_LEDS + POWER_SEGMENT_LEDS - 1) / POWER_SEGMENT_LEDS> powerLimiter(POWER_SEGMENT_LEDS, POWER_SEGMENT_MAX_MA, POWER_MAX_MA);
+
+// Set when power is off and the LEDs have been switched off
+bool idle = false;
+
+// Realtime frames streamed over UDP, written straight into leds[]
+#if DDP_MATRIX_MAPPED
+DdpReceiver ddp(leds, NUM_LEDS, ledmap_matrix, LED_MATRIX_ROWS * LED_MATRIX_COLS, DDP_TIMEOUT_MS);
+#else
+DdpReceiver ddp(leds, NUM_LEDS, DDP_TIMEOUT_MS);
+#endif
+
+// Set while the frames come from the network instead of the animations
+bool streaming = false;
+
+// Shared timeline with the other nodes: they show the same frame numbers, with the same random numbers
+FrameSync frameSync(SYNC_MODE, SYNC_INTERVAL_MS);
+
+unsigned long lastMqttAttemptMillis = 0;
+unsigned long mqttBackoffMillis = 0;
+
+// MQTT_SERVER is resolved once in setup(), so that the reconnections do not wait for the DNS
+IPAddress mqttServerAddress;
+bool mqttServerResolved = false;
+
+void debugCommand() {
+    String command = Debug.getLastCommand();
+
+    if ( command == "stats" ) {
+        char text[512];
+        profiler.formatText(text, sizeof(text));
+        Debug.print(text);
+    }
+    else if ( command == "stats reset" ) {
+        profiler.reset();
+        Debug.println("Frame statistics reset");
+    }
+    else if ( command == "power" ) {
+        Debug.printf("Estimated current: %u mA, brightness limit: %u, limited frames: %u\n",
+            powerLimiter.getTotalCurrent(), powerLimiter.getLimit(), powerLimiter.getLimitedFrames());
+    }
+    else if ( command == "metrics" ) {
+        char json[256];
+        metrics.formatJson(json, sizeof(json));
+        Debug.println(json);
+    }
+    else if ( command == "heap" ) {
+        Debug.printf("Free heap: %u, largest free block: %u, fragmentation: %u%%, arena: %u/%u\n",
+            ESP.getFreeHeap(), ESP.getMaxFreeBlockSize(), ESP.getHeapFragmentation(), (uint)arena.getUsed(), (uint)arena.getSize());
+    }
+}
+
+void publishStats() {
+    char json[384];
+    profiler.formatJson(json, sizeof(json));
+    mqtt.publish(MQTT_STATS_TOPIC, json);
+
+    snprintf(json, sizeof(json), "{\"free\":%u,\"max_block\":%u,\"fragmentation\":%u,\"arena_used\":%u,\"arena_size\":%u}",
+        ESP.getFreeHeap(), ESP.getMaxFreeBlockSize(), ESP.getHeapFragmentation(), (uint)arena.getUsed(), (uint)arena.getSize());
+    mqtt.publish(MQTT_HEAP_TOPIC, json);
+}
+
+// The gauges that are not updated by the loop are sampled here, they are too slow to read at each frame
+void publishMetrics() {
+    metrics.set(GAUGE_RSSI, WiFi.RSSI());
+    metrics.set(GAUGE_FREE_HEAP, ESP.getFreeHeap());
+    metrics.set(GAUGE_UPTIME, millis() / 1000);
+
+    char json[256];
+    metrics.formatJson(json, sizeof(json));
+    mqtt.publish(MQTT_METRICS_TOPIC, json);
+    metrics.resetPeaks();
+}
+
+bool mqttconnect() {
     Serial.print("MQTT connecting... ");
 
     // Connect to MQTT, with retained last will message "offline"
@@ -44,61 +193,125 @@ void mqttconnect() {
         Serial.println("MQTT connected");
 
         // Subscribe to the topics with QoS 1
-        mqtt.subscribe(MQTT_COLOR_TOPIC, 1);
-        mqtt.subscribe(MQTT_POWER_TOPIC, 1);
-        mqtt.subscribe(MQTT_CHNGIMG_TOPIC, 1);
-        mqtt.subscribe(MQTT_CHNGANIM_TOPIC, 1);
+        for ( const MqttTopic &topic : command_topics ) {
+            mqtt.subscribe(topic.topic, 1);
+        }
 
         // Update status, message is retained
         mqtt.publish(MQTT_STATUS_TOPIC, "online", true);
+        return true;
     }
     else {
         Serial.print("failed, status code =");
-        Serial.print(mqtt.state());
+        Serial.println(mqtt.state());
+        return false;
     }
 }
 
-void mqttCallback(char* topic, byte* payload, unsigned int length) {
-    // Convert topic and payload to strings
-    std::string topic_str(topic);
-    std::string payload_str;
-    for ( uint i = 0; i < length; i++ ) {
-        payload_str += (char)payload[i];
+// Resolve MQTT_SERVER (an IP address or a host name), the DNS request waits at most timeout_ms
+bool mqttResolveServer(uint32_t timeout_ms) {
+    if ( WiFi.hostByName(MQTT_SERVER, mqttServerAddress, timeout_ms) != 1 ) {
+        Serial.println("MQTT server not resolved");
+        return false;
     }
+    mqtt.setServer(mqttServerAddress, MQTT_PORT);
+    mqttServerResolved = true;
+    return true;
+}
 
-    if ( topic_str.compare(MQTT_COLOR_TOPIC) == 0 ) {
-        // Convert hex string to integer
-        unsigned long color = strtoul(payload_str.substr(1, 6).c_str(), nullptr, 16);
-        requested_color.r = color >> 16;
-        requested_color.g = color >> 8;
-        requested_color.b = color;
+// Reconnect without stalling the animations for long: the connection timeout is short, and the attempts are spaced
+// with an exponential backoff when the broker is unreachable. Each attempt can still delay a few frames.
+void mqttReconnect() {
+    if ( millis() - lastMqttAttemptMillis < mqttBackoffMillis ) {
+        return;
     }
+    lastMqttAttemptMillis = millis();
+
+    // Only if the address could not be resolved in setup(), e.g. the WiFi was not connected yet
+    if ( (mqttServerResolved || mqttResolveServer(MQTT_CONNECT_TIMEOUT_MS)) && mqttconnect() ) {
+        mqttBackoffMillis = 0;
+        if ( mqttConnectedOnce ) {
+            metrics.add(COUNTER_MQTT_RECONNECTS);
+        }
+        mqttConnectedOnce = true;
+    }
+    else {
+        mqttBackoffMillis = constrain(mqttBackoffMillis * 2, MQTT_RECONNECT_MIN_MS, MQTT_RECONNECT_MAX_MS);
+    }
+}
 
-    if ( topic_str.compare(MQTT_POWER_TOPIC) == 0 ) {
-        if ( payload_str.compare("ON") == 0 ) {
-            power_is_on = true;
+void mqttCallback(char* topic, byte* payload, unsigned int length) {
+    Command command;
+    if ( commandParser.parse(topic, payload, length, command) ) {
+        if ( command.type == COMMAND_SHADER ) {
+            if ( length > sizeof(shader_payload) ) {
+                Debug.printf("Shader too long: %u bytes\n", length);
+                return;
+            }
+            memcpy(shader_payload, payload, length);
+            shader_payload_length = length;
         }
-        else if ( payload_str.compare("OFF") == 0 ){
-            power_is_on = false;
+        commands.push(command);
+    }
+    else {
+        Debug.printf("Invalid MQTT command on %s\n", topic);
+    }
+}
+
+// True if name is one of the words of list (separated by spaces)
+bool nameInList(const char *name, const char *list) {
+    size_t length = strlen(name);
+    if ( length == 0 ) {
+        return false;
+    }
+
+    for ( const char *word = strstr(list, name); word; word = strstr(word + length, name) ) {
+        if ( (word == list || word[-1] == ' ') && (word[length] == ' ' || word[length] == '\0') ) {
+            return true;
         }
     }
+    return false;
+}
 
-    if ( topic_str.compare(MQTT_CHNGIMG_TOPIC) == 0 ) {
-        change_image_request = true;
+// Overlays that depend on the current animation
+void updateOverlays() {
+    compositor.get<SparkleLayer>().setDensity(nameInList(animations.getName(), SPARKLE_ANIMATIONS) ? SPARKLE_DENSITY : 0);
+}
+
+// Select an animation by name or index, any other value selects the next animation
+void selectAnimation(const char *request) {
+    uint previous = animations.getCurrent();
+
+    if ( !animations.selectByName(request) ) {
+        char *end;
+        unsigned long index = strtoul(request, &end, 10);
+        if ( end != request && *end == '\0' && index < animations.size() ) {
+            animations.select(index);
+        }
+        else {
+            animations.selectNext();
+        }
     }
 
-    if ( topic_str.compare(MQTT_CHNGANIM_TOPIC) == 0 ) {
-        change_animation_request = true;
+    // The last frame of the previous animation fades out over the new one
+    if ( animations.getCurrent() != previous ) {
+        compositor.get<CrossfadeLayer>().start(shown_leds, CROSSFADE_MS * animations.getFramerate() / 1000);
+        ledMatrix.clearOutsideMatrix(ledmap_matrix_inverse);
+        updateOverlays();
     }
 }
 
 void setup() {
     Serial.begin(115200);
 
+#if LED_OUTPUT_UART1
+    ledOutput.begin();
+#else
     FastLED.addLeds<CHIPSET, LED_PIN, COLOR_ORDER>(leds, NUM_LEDS);
-    FastLED.setBrightness( DEFAULT_BRIGHTNESS );
     FastLED.setMaxRefreshRate( MAX_REFRESH_RATE ); // Avoids flickering
     FastLED.setCorrection(TypicalLEDStrip);
+#endif
+    FastLED.setBrightness( DEFAULT_BRIGHTNESS );
 
     WiFi.mode(WIFI_STA);
     WiFi.hostname( WIFI_HOSTNAME );
@@ -114,6 +327,10 @@ void setup() {
     Debug.setResetCmdEnabled(true);
     Debug.showProfiler(true);
     Debug.showColors(true);
+    Debug.setHelpProjectsCmds("stats - frame time per loop stage (us)\r\nstats reset - reset the frame statistics\r\n"
+        "heap - free heap, largest free block and fragmentation\r\npower - estimated current and brightness limit\r\n"
+        "metrics - counters and gauges published on MQTT");
+    Debug.setCallBackProjectCmds(&debugCommand);
 
     ArduinoOTA.setPassword( OTA_PWD );
     ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
@@ -124,93 +341,177 @@ void setup() {
         });
     ArduinoOTA.begin();
 
-    mqtt.setServer(MQTT_SERVER, MQTT_PORT);
+    wifiClient.setTimeout(MQTT_CONNECT_TIMEOUT_MS);
+    mqtt.setSocketTimeout(1); // Seconds, the CONNACK of a broker that accepted the TCP connection
+    mqttResolveServer(WIFI_TIMEOUT_MS);
     mqtt.setCallback(mqttCallback);
+    mqtt.setBufferSize(SHADER_MAX_HEX_SIZE + 128); // Room for the frame statistics and the longest shader bytecode
 
     // Start with some violet
-    requested_color.r = 0x9A;
-    requested_color.g = 0x03;
-    requested_color.b = 0xAC;
+    RgbColor color;
+    color.r = 0x9A;
+    color.g = 0x03;
+    color.b = 0xAC;
+    animations.forEach([&color](auto &animation) { animation.setColor(color); });
 
     // Load a picture
-    scrollingPicture.loadNextBMP();
+    animations.forEach([](auto &animation) { animation.nextImage(); });
+    updateOverlays();
+
+    ddp.begin(DDP_PORT);
+    frameSync.begin(WiFi.localIP(), SYNC_MULTICAST_ADDRESS, SYNC_PORT);
 }
 
-void loop() {
-    unsigned long loopStartMillis = millis();
+// True if there is enough time left before the next frame for slow network work
+bool hasSlack() {
+    return idle || scheduler.slackMicros(micros()) > (long)scheduler.getPeriodMicros() / 2;
+}
+
+// Network work, done in the time left before the next frame
+void serviceNetwork() {
+    profiler.skip();
 
     ArduinoOTA.handle();
+    profiler.mark(STAGE_OTA);
+
     Debug.handle();
+    profiler.mark(STAGE_DEBUG);
 
-    if ( WiFi.status() == WL_CONNECTED && !mqtt.connected() ) {
-        mqttconnect();
+    // Only try to reconnect if there is time left before the next frame, the connection can take a while
+    if ( WiFi.status() == WL_CONNECTED && !mqtt.connected() && hasSlack() ) {
+        mqttReconnect();
     }
     mqtt.loop();
+    frameSync.poll(micros(), millis());
+
+    // At most one publication per loop. The metrics wait for a loop with time left before the next frame, but not
+    // longer than another interval, so that an overloaded node still reports.
+    unsigned long now = millis();
+    if ( mqtt.connected() && now - lastStatsPublishMillis > STATS_PUBLISH_INTERVAL_MS ) {
+        publishStats();
+        lastStatsPublishMillis = now;
+    }
+    else if ( mqtt.connected() && now - lastMetricsPublishMillis > METRICS_PUBLISH_INTERVAL_MS
+            && (hasSlack() || now - lastMetricsPublishMillis > 2 * METRICS_PUBLISH_INTERVAL_MS) ) {
+        publishMetrics();
+        lastMetricsPublishMillis = now;
+    }
+    profiler.mark(STAGE_MQTT);
+}
+
+// Send the LEDs (leds or output_leds) to the strip with the current brightness
+void showLeds(const CRGB *pixels) {
+    unsigned long start_us = micros();
+    shown_leds = pixels;
+#if LED_OUTPUT_UART1
+    // Same color correction as FastLED, the UART output returns while the frame is being sent
+    CRGB scale = CRGB(TypicalLEDStrip);
+    scale.nscale8(FastLED.getBrightness());
+    ledOutput.show(pixels, scale);
+#else
+    FastLED[0].setLeds(const_cast<CRGB *>(pixels), NUM_LEDS);
+    FastLED.show();
+#endif
+    metrics.setMax(GAUGE_SHOW_US, micros() - start_us);
+}
 
-    // Reset all LEDs
-    for (uint i = 0; i < NUM_LEDS; i++) {
-        leds[i] = CRGB::Black;
+void publishCurrentAnimation() {
+    char message[64];
+    if ( streaming ) {
+        strcpy(message, "Realtime (DDP)");
+    }
+    else {
+        animations.formatStatus(message, sizeof(message));
     }
+    mqtt.publish(MQTT_CURRENT_ANIM_TOPIC, message);
+}
 
-    // Process requests
+// Execute the commands received since the previous loop
+void processCommands() {
     bool send_update = false;
-    if ( change_image_request ) {
-        scrollingPicture.loadNextBMP();
-        change_image_request = false;
-        send_update = true;
-    }
+    Command command;
+
+    while ( commands.pop(command) ) {
+        switch ( command.type ) {
+            case COMMAND_COLOR: {
+                RgbColor color;
+                color.r = command.value >> 16;
+                color.g = command.value >> 8;
+                color.b = command.value;
+                animations.forEach([&color](auto &animation) { animation.setColor(color); });
+                break;
+            }
 
-    if ( change_animation_request ) {
-        current_animation = current_animation < N_ANIMATIONS-1 ? current_animation+1 : 0;
-        change_animation_request = false;
-        send_update = true;
-    }
+            // The LEDs fade out before switching off, and fade in when switched on
+            case COMMAND_POWER:
+                power_is_on = command.value;
+                compositor.get<FadeLayer>().fadeTo(power_is_on ? 0 : 255, POWER_FADE_MS * animations.getFramerate() / 1000);
+                break;
 
-    if ( send_update ) {
-        String message = "";
-        switch ( current_animation ) {
-            case 0 :
-                message = "Points: RGB=" + String(requested_color.r) + "," + String(requested_color.g) + "," + String(requested_color.b);
+            case COMMAND_BRIGHTNESS:
+                brightness = command.value;
                 break;
-            case 1 :
-                message = "Image: " + String( scrollingPicture.getCurrentBmpFilename().c_str() );
+
+            case COMMAND_FPS:
+                animations.setFramerate(command.value);
+                send_update = true;
                 break;
-        }
-        mqtt.publish(MQTT_CURRENT_ANIM_TOPIC, message.c_str());
-        send_update = false;
-    }
 
-    // Only compute animations if power is set to ON
-    if ( power_is_on ) {
-        int hue = RgbToHsv(requested_color).h;
+            case COMMAND_ANIMATION:
+                selectAnimation(command.name);
+                send_update = true;
+                break;
 
-        // Compute animation step
-        switch ( current_animation ) {
-            case 0:
-                runningDots.setHue( hue );
-                runningDots.nextFrame();
-                framerate = FRAMES_PER_SECOND_RUNNINGDOTS;
+            // The picture is loaded in the background, the status is published when it is shown (see renderFrame)
+            case COMMAND_IMAGE:
+                if ( command.name[0] == '\0' ) {
+                    animations.forEach([](auto &animation) { animation.nextImage(); });
+                }
+                else {
+                    animations.selectImage(command.name);
+                }
                 break;
 
-            case 1:
-                scrollingPicture.nextFrame();
-                framerate = FRAMES_PER_SECOND_SCROLLINGPICTURE;
+            case COMMAND_SHADER:
+                animations.forEach([](auto &animation) {
+                    if constexpr ( std::is_same<std::decay_t<decltype(animation)>, ShaderAnimation>::value ) {
+                        if ( !animation.loadShader(shader_payload, shader_payload_length) ) {
+                            char status[64];
+                            animation.formatStatus(status, sizeof(status));
+                            Debug.printf("%s\n", status);
+                        }
+                    }
+                });
+                send_update = true;
                 break;
         }
-        
-        // Map leds
-        for (uint row = 0; row < ledMatrix.size(); row++) {
-            for (uint col = 0; col < ledMatrix[row].size(); col++) {
-                leds[ ledmap_vertical[row][col] ] = ledMatrix[row][col];
-                // leds[ ledmap_vertical[row][col] ] = (row % 2) == 0 ? CRGB::Red : CRGB::Green; // Used to align the columns when installing the LED strips
-            }
-        }
     }
 
+    if ( send_update ) {
+        publishCurrentAnimation();
+    }
+}
+
+// Advance the animation by the given number of steps and show the result
+void renderFrame(uint steps) {
+    profiler.skip();
+
+    // Compute the animation steps, only the last one is shown
+    scheduler.setFramerate(animations.getFramerate());
+    frameSync.advance(animations, scheduler, steps);
+    if ( animations.statusChanged() ) {
+        publishCurrentAnimation();
+    }
+
+    // Used to align the columns when installing the LED strips
+    // for (uint row = 0; row < LED_MATRIX_ROWS; row++) {
+    //     ledMatrix.fillRow(row, (row % 2) == 0 ? CRGB::Red : CRGB::Green);
+    // }
+
 // Used for testing without a LED strip (displays the last column on the serial port)
 /*
-    for ( auto row : ledMatrix ) {
-        if ( row[14].getLuma() > 10 ){ 
+    for ( uint row = 0; row < LED_MATRIX_ROWS; row++ ) {
+        if ( ledMatrix.at(row, 14).getLuma() > 10 ){ 
             Serial.print(".");
         }
         else {
@@ -219,10 +520,112 @@ void loop() {
     }
     Serial.println();
 */
-    FastLED.show();
+    profiler.mark(STAGE_ANIMATION);
+
+    // Single pass over the LEDs for all the overlays, none when they are all transparent
+    const CRGB *pixels = compositor.compose(animations.getFramerate());
+    profiler.mark(STAGE_COMPOSE);
+
+    // The current estimation and the frame hash are computed in the same pass over the LEDs
+    uint32_t frame_hash = powerLimiter.scan(pixels, NUM_LEDS);
+    FastLED.setBrightness(powerLimiter.apply(brightness));
+    if ( frameChangeDetector.changed(frame_hash, FastLED.getBrightness(), millis()) ) {
+        showLeds(pixels);
+        metrics.add(COUNTER_SHOWN);
+    }
+    profiler.mark(STAGE_SHOW);
+
+    uint dropped = scheduler.getDroppedFrames() - droppedFramesReported;
+    profiler.endFrame(dropped);
+    metrics.add(COUNTER_FRAMES);
+    metrics.add(COUNTER_DROPPED, dropped);
+    droppedFramesReported = scheduler.getDroppedFrames();
+    profiler.beginFrame();
+}
+
+// Power is off: switch the LEDs off once, then only service the network until an MQTT message switches the power on
+void idleLoop() {
+    if ( !idle ) {
+        fill_solid(leds, NUM_LEDS, CRGB::Black);
+        showLeds(leds);
+        frameChangeDetector.invalidate();
+        idle = true;
+    }
+
+    serviceNetwork();
+    delay(IDLE_LOOP_DELAY_MS);
+}
+
+// Frames streamed over UDP take over the animations, until no packet has been received for DDP_TIMEOUT_MS.
+// Returns false when the animations must run.
+bool streamingLoop() {
+    if ( ddp.poll(millis()) ) {
+#if DDP_MATRIX_MAPPED
+        // Only the matrix is streamed: the LEDs outside of it must not keep the colors of the last animation
+        if ( !streaming ) {
+            ledMatrix.clearOutsideMatrix(ledmap_matrix_inverse);
+        }
+#endif
+        powerLimiter.scan(leds, NUM_LEDS);
+        FastLED.setBrightness(powerLimiter.apply(brightness));
+        showLeds(leds);
+    }
+
+    if ( ddp.isActive() != streaming ) {
+        streaming = ddp.isActive();
+        if ( !streaming ) {
+            // Back to the animations, on a new timeline
+            scheduler.restart();
+            frameChangeDetector.invalidate();
+            profiler.beginFrame();
+        }
+        publishCurrentAnimation();
+    }
 
-    long neededDelay = (1000 / framerate) - (millis() - loopStartMillis);
-    if ( neededDelay > 0 ) {
-        FastLED.delay( neededDelay );
+    if ( streaming ) {
+        serviceNetwork();
     }
-}
\ No newline at end of file
+    return streaming;
+}
+
+void loop() {
+    unsigned long loop_start_us = micros();
+    profiler.skip();
+    processCommands();
+    profiler.mark(STAGE_REQUESTS);
+
+    // Once switched off, the animation goes on until it has faded out
+    if ( !power_is_on && (streaming || compositor.get<FadeLayer>().isDone()) ) {
+        idleLoop();
+        return;
+    }
+
+    if ( idle ) {
+        idle = false;
+        scheduler.restart();
+        profiler.beginFrame();
+    }
+
+    if ( streamingLoop() ) {
+        return;
+    }
+
+    uint steps = scheduler.stepsDue(micros());
+    if ( steps > 0 ) {
+        renderFrame(steps);
+    }
+
+    serviceNetwork();
+
+    // Loops longer than a frame delay the next frame
+    unsigned long loop_us = micros() - loop_start_us;
+    metrics.setMax(GAUGE_LOOP_US, loop_us);
+    if ( loop_us > scheduler.getPeriodMicros() ) {
+        metrics.add(COUNTER_OVERRUNS);
+    }
+
+    // Sleep if there is nothing to do before the next frame
+    if ( scheduler.slackMicros(micros()) > 2000 ) {
+        delay(1);
+    }
+}
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""Convert an animation to the .lfr format played by the MoviePlayer animation.
+
+The .lfr format stores the frames in matrix order (row-major, row 0 is the bottom row of the picture), each frame
+delta-compressed against the previous one, with its duration. See include/FrameRecorder.hpp for the format
+description (timed stream "LFR2").
+
+The input is an animated GIF (the frame durations of the GIF are kept), or a list of pictures shown at --fps.
+Uncompressed BMP files are read directly, other formats need Pillow (pip install pillow). Without input, --demo
+generates a test animation.
+
+Usage:
+  anim2lfr.py fireworks.gif data/fireworks.lfr --rows 25 --cols 15
+  anim2lfr.py frame1.bmp frame2.bmp frame3.bmp data/blink.lfr --fps 5
+  anim2lfr.py --demo snow data/snow.lfr --rows 25 --cols 15
+"""
+
+import argparse
+import random
+import struct
+import sys
+
+from img2lci import read_picture
+
+MAGIC = b"LFR2"
+MAX_GAP = 1  # Unchanged pixels that are cheaper to store than a new run header (same as FrameRecorder)
+
+
+def read_gif(path):
+    """Returns a list of (width, height, rows, duration_ms) with rows[0] being the top row."""
+    try:
+        from PIL import Image, ImageSequence
+    except ImportError:
+        sys.exit("Pillow is needed to read %s (pip install pillow)" % path)
+
+    frames = []
+    image = Image.open(path)
+    for frame in ImageSequence.Iterator(image):
+        rgb = frame.convert("RGB")
+        width, height = rgb.size
+        pixels = list(rgb.getdata())
+        rows = [pixels[row * width : (row + 1) * width] for row in range(height)]
+        frames.append((width, height, rows, frame.info.get("duration", 100)))
+    return frames
+
+
+def demo_snow(rows, cols, count):
+    """Snowflakes falling at different speeds."""
+    rng = random.Random(1)
+    flakes = []
+    frames = []
+    for _ in range(count):
+        if rng.random() < 0.5:
+            flakes.append([rng.randrange(cols), float(rows - 1), rng.uniform(0.2, 0.6)])
+
+        picture = [[(0, 0, 16) for _ in range(cols)] for _ in range(rows)]
+        for flake in flakes:
+            flake[1] -= flake[2]
+            if flake[1] >= 0:
+                # Top row first
+                picture[rows - 1 - int(flake[1])][flake[0]] = (200, 200, 255)
+        flakes = [flake for flake in flakes if flake[1] >= 0]
+        frames.append((cols, rows, picture, 40))
+    return frames
+
+
+def encode(frames):
+    width, height = frames[0][0], frames[0][1]
+    out = bytearray(MAGIC + struct.pack("<HH", width * height, width))
+    previous = [(0, 0, 0)] * (width * height)
+
+    for _, _, rows, duration in frames:
+        # Row-major, row 0 is the bottom of the picture
+        pixels = [rows[height - 1 - row][col] for row in range(height) for col in range(width)]
+
+        runs = []
+        index = 0
+        while index < len(pixels):
+            if pixels[index] == previous[index]:
+                index += 1
+                continue
+            first = index
+            last = index + 1
+            next_index = last
+            while next_index < len(pixels) and next_index <= last + MAX_GAP:
+                if pixels[next_index] != previous[next_index]:
+                    last = next_index + 1
+                next_index += 1
+            runs.append((first, last - first))
+            index = last
+
+        out += struct.pack("<HH", min(duration, 0xFFFF), len(runs))
+        for first, length in runs:
+            out += struct.pack("<HH", first, length)
+            for color in pixels[first : first + length]:
+                out += bytes(color)
+        previous = pixels
+
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert an animation to the .lfr format (MoviePlayer)")
+    parser.add_argument("files", nargs="+", help="Animated GIF or pictures, then the output .lfr file")
+    parser.add_argument("--fps", type=float, default=10, help="Frame rate of a list of pictures")
+    parser.add_argument("--rows", type=int, help="Check that the frames match the LED matrix rows")
+    parser.add_argument("--cols", type=int, help="Check that the frames match the LED matrix columns")
+    parser.add_argument("--demo", choices=["snow"], help="Generate a test animation instead (needs --rows and --cols)")
+    parser.add_argument("--frames", type=int, default=250, help="Length of the demo animation")
+    args = parser.parse_args()
+
+    inputs, output = args.files[:-1], args.files[-1]
+    if args.demo:
+        if args.rows is None or args.cols is None:
+            sys.exit("--demo needs --rows and --cols")
+        frames = demo_snow(args.rows, args.cols, args.frames)
+    elif len(inputs) == 1 and inputs[0].lower().endswith(".gif"):
+        frames = read_gif(inputs[0])
+    elif inputs:
+        duration = int(round(1000 / args.fps))
+        frames = [read_picture(path) + (duration,) for path in inputs]
+    else:
+        sys.exit("No input")
+
+    width, height = frames[0][0], frames[0][1]
+    if any(frame[0] != width or frame[1] != height for frame in frames):
+        sys.exit("The frames have different sizes")
+    if args.rows is not None and height != args.rows:
+        sys.exit("The frame height is %d, the LED matrix has %d rows" % (height, args.rows))
+    if args.cols is not None and width != args.cols:
+        sys.exit("The frame width is %d, the LED matrix has %d columns" % (width, args.cols))
+    if width * height > 0xFFFF:
+        sys.exit("The frames are too large")
+
+    lfr = encode(frames)
+    with open(output, "wb") as f:
+        f.write(lfr)
+
+    print("%s: %d frames of %dx%d, %d bytes (raw RGB: %d bytes)" % (output, len(frames), width, height, len(lfr),
+          len(frames) * width * height * 3))
+
+
+if __name__ == "__main__":
+    main()
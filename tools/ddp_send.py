@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Stream test frames to the lights with the DDP protocol (see include/DdpReceiver.hpp).
+
+The frames are sent as RGB pixels, row-major for the matrix (the receiver maps them to the LEDs), or in the order of
+the LED strip when the receiver is built with DDP_MATRIX_MAPPED 0 (use --leds). Large frames are split in several
+packets, the last one has the PUSH flag.
+
+Usage:
+  ddp_send.py beautifulLights.local --rows 25 --cols 15 --fps 50 --seconds 10
+  ddp_send.py 127.0.0.1 --leds 80 --pattern bars
+"""
+
+import argparse
+import colorsys
+import socket
+import struct
+import time
+
+DDP_PORT = 4048
+FLAG_VERSION_1 = 0x40
+FLAG_PUSH = 0x01
+DATA_TYPE_RGB8 = 0x0B
+ID_DISPLAY = 1
+MAX_PIXELS_PER_PACKET = 480  # 1440 bytes of data, fits in an ethernet frame
+
+
+def rainbow(frame, rows, cols):
+    """Diagonal rainbow moving to the right."""
+    pixels = bytearray()
+    for row in range(rows):
+        for col in range(cols):
+            hue = ((col + row - frame) % 32) / 32
+            r, g, b = colorsys.hsv_to_rgb(hue, 1, 1)
+            pixels += bytes((int(r * 255), int(g * 255), int(b * 255)))
+    return pixels
+
+
+def bars(frame, rows, cols):
+    """A white pixel running through the frame, row 0 in red and column 0 in green to check the orientation."""
+    pixels = bytearray()
+    position = frame % (rows * cols)
+    for row in range(rows):
+        for col in range(cols):
+            if row * cols + col == position:
+                pixels += b"\xff\xff\xff"
+            elif row == 0:
+                pixels += b"\x40\x00\x00"
+            elif col == 0:
+                pixels += b"\x00\x40\x00"
+            else:
+                pixels += b"\x00\x00\x00"
+    return pixels
+
+
+PATTERNS = {"rainbow": rainbow, "bars": bars}
+
+
+def packets(pixels, sequence, pixels_per_packet):
+    """Yields the packets of a frame, numbered from sequence."""
+    step = pixels_per_packet * 3
+    for offset in range(0, len(pixels), step):
+        data = pixels[offset:offset + step]
+        flags = FLAG_VERSION_1 | (FLAG_PUSH if offset + step >= len(pixels) else 0)
+        header = struct.pack(">BBBBIH", flags, sequence, DATA_TYPE_RGB8, ID_DISPLAY, offset, len(data))
+        yield header + data
+        sequence = sequence % 15 + 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=DDP_PORT)
+    parser.add_argument("--rows", type=int, default=25)
+    parser.add_argument("--cols", type=int, default=15)
+    parser.add_argument("--leds", type=int, help="raw mode: number of LEDs of the strip (a single row)")
+    parser.add_argument("--fps", type=float, default=40)
+    parser.add_argument("--seconds", type=float, default=5)
+    parser.add_argument("--pattern", choices=PATTERNS, default="rainbow")
+    parser.add_argument("--pixels-per-packet", type=int, default=MAX_PIXELS_PER_PACKET)
+    parser.add_argument("--drop", type=int, default=0, help="drop every Nth packet, to test the loss counter")
+    args = parser.parse_args()
+
+    rows, cols = (1, args.leds) if args.leds else (args.rows, args.cols)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    period = 1 / args.fps
+    frames = int(args.seconds * args.fps)
+
+    sequence = 1
+    sent = dropped = 0
+    start = time.monotonic()
+    for frame in range(frames):
+        pixels = PATTERNS[args.pattern](frame, rows, cols)
+        for packet in packets(pixels, sequence, args.pixels_per_packet):
+            sequence = sequence % 15 + 1
+            sent += 1
+            if args.drop and sent % args.drop == 0:
+                dropped += 1
+                continue
+            sock.sendto(packet, (args.host, args.port))
+
+        # Absolute deadlines, so that the frame rate does not drift
+        delay = start + (frame + 1) * period - time.monotonic()
+        if delay > 0:
+            time.sleep(delay)
+
+    print(f"{frames} frames, {sent - dropped} packets sent, {dropped} dropped")
+
+
+if __name__ == "__main__":
+    main()
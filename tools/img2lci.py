@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""Convert a picture to the .lci format displayed by the ScrollingPicture animation.
+
+The .lci format stores the pixels column-major (the order in which the picture scrolls), palette + RLE compressed
+when the picture has 256 colors or less. See include/ColumnImage.hpp for the format description.
+
+Uncompressed 24/32 bit BMP files are read directly, other formats (PNG, GIF, ...) need Pillow (pip install pillow).
+
+Usage: img2lci.py input.png data/output.lci [--height 25]
+"""
+
+import argparse
+import struct
+import sys
+
+ENCODING_RAW = 0
+ENCODING_PALETTE_RLE = 1
+HEADER_SIZE = 16
+
+
+def read_bmp(path):
+    """Returns (width, height, rows) with rows[0] being the top row of the picture, as lists of (r, g, b)."""
+    with open(path, "rb") as f:
+        data = f.read()
+
+    if data[0:2] != b"BM":
+        raise ValueError("not a BMP file")
+
+    data_offset = struct.unpack_from("<I", data, 10)[0]
+    width, height = struct.unpack_from("<ii", data, 18)
+    bits_per_pixel, compression = struct.unpack_from("<HI", data, 28)
+
+    if bits_per_pixel not in (24, 32) or compression not in (0, 3):
+        raise ValueError("only uncompressed 24 or 32 bit BMP files are supported")
+
+    bottom_up = height > 0
+    height = abs(height)
+    bytes_per_pixel = bits_per_pixel // 8
+    row_size = (width * bits_per_pixel + 31) // 32 * 4
+
+    rows = []
+    for row in range(height):
+        offset = data_offset + row * row_size
+        pixels = []
+        for col in range(width):
+            b, g, r = data[offset + col * bytes_per_pixel : offset + col * bytes_per_pixel + 3]
+            pixels.append((r, g, b))
+        rows.append(pixels)
+
+    if bottom_up:
+        rows.reverse()
+
+    return width, height, rows
+
+
+def read_picture(path):
+    try:
+        return read_bmp(path)
+    except (ValueError, struct.error):
+        pass
+
+    try:
+        from PIL import Image
+    except ImportError:
+        sys.exit("Pillow is needed to read %s (pip install pillow)" % path)
+
+    image = Image.open(path).convert("RGB")
+    width, height = image.size
+    pixels = list(image.getdata())
+    rows = [pixels[row * width : (row + 1) * width] for row in range(height)]
+    return width, height, rows
+
+
+def rle_encode(indices):
+    """PackBits-like: control < 128 -> run of control+1 copies of the next byte, control >= 128 -> control-127
+    literal bytes."""
+    out = bytearray()
+    literals = bytearray()
+    i = 0
+
+    def flush_literals():
+        while literals:
+            chunk = literals[:128]
+            out.append(127 + len(chunk))
+            out.extend(chunk)
+            del literals[: len(chunk)]
+
+    while i < len(indices):
+        run = 1
+        while i + run < len(indices) and indices[i + run] == indices[i] and run < 128:
+            run += 1
+
+        if run >= 3:
+            flush_literals()
+            out.append(run - 1)
+            out.append(indices[i])
+            i += run
+        else:
+            literals.append(indices[i])
+            i += 1
+
+    flush_literals()
+    return bytes(out)
+
+
+def encode(width, height, rows):
+    # Column-major, row 0 is the bottom of the picture
+    pixels = [rows[height - 1 - row][col] for col in range(width) for row in range(height)]
+
+    palette = sorted(set(pixels))
+    if len(palette) <= 256:
+        index_of = {color: index for index, color in enumerate(palette)}
+        encoding = ENCODING_PALETTE_RLE
+        palette_bytes = b"".join(bytes(color) for color in palette)
+        pixel_bytes = rle_encode([index_of[p] for p in pixels])
+        palette_count = len(palette)
+    else:
+        encoding = ENCODING_RAW
+        palette_bytes = b""
+        pixel_bytes = b"".join(bytes(p) for p in pixels)
+        palette_count = 1
+
+    data_offset = HEADER_SIZE + len(palette_bytes)
+    header = b"LCI1" + struct.pack("<HHBBHI", width, height, encoding, palette_count - 1, 0, data_offset)
+    return header + palette_bytes + pixel_bytes
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a picture to the .lci format (ScrollingPicture)")
+    parser.add_argument("input", help="BMP, PNG, or any format supported by Pillow")
+    parser.add_argument("output", help="Output .lci file, usually in the data folder")
+    parser.add_argument("--height", type=int, help="Check that the picture height matches the LED matrix rows")
+    args = parser.parse_args()
+
+    width, height, rows = read_picture(args.input)
+    if args.height is not None and height != args.height:
+        sys.exit("The picture height is %d, the LED matrix has %d rows" % (height, args.height))
+    if width > 0xFFFF or height > 0xFFFF:
+        sys.exit("The picture is too large")
+
+    lci = encode(width, height, rows)
+    with open(args.output, "wb") as f:
+        f.write(lci)
+
+    print("%s: %dx%d, %d bytes (raw RGB: %d bytes)" % (args.output, width, height, len(lci), width * height * 3))
+
+
+if __name__ == "__main__":
+    main()